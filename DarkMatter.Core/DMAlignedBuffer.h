@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace dm::core
+{
+	// Fixed size heap array whose first element sits on an Alignment byte boundary (a cache line by default), for bulk
+	// data that gets scanned, SIMD processed or handed straight to an upload. Limited to trivially copyable types.
+	template <typename T, size_t Alignment = 64>
+	class AlignedBuffer
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0);
+
+	public:
+		AlignedBuffer() = default;
+
+		explicit AlignedBuffer(size_t size, const T& value = T{}) : _data(Allocate(size)), _size(size)
+		{
+			std::uninitialized_fill_n(_data.get(), size, value);
+		}
+
+		// leaves the contents uninitialized, for buffers that get filled in parallel or read from a file right away
+		static AlignedBuffer Uninitialized(size_t size)
+		{
+			AlignedBuffer buffer;
+			buffer._data.reset(Allocate(size));
+			buffer._size = size;
+			return buffer;
+		}
+
+		AlignedBuffer(const AlignedBuffer& other) : _data(Allocate(other._size)), _size(other._size)
+		{
+			std::copy_n(other._data.get(), _size, _data.get());
+		}
+
+		AlignedBuffer& operator=(const AlignedBuffer& other)
+		{
+			if (this != &other)
+			{
+				*this = AlignedBuffer(other);
+			}
+
+			return *this;
+		}
+
+		AlignedBuffer(AlignedBuffer&& other) noexcept : _data(std::move(other._data)), _size(std::exchange(other._size, 0)) {}
+
+		AlignedBuffer& operator=(AlignedBuffer&& other) noexcept
+		{
+			_data = std::move(other._data);
+			_size = std::exchange(other._size, 0);
+			return *this;
+		}
+
+		[[nodiscard]] T* data() { return _data.get(); }
+		[[nodiscard]] const T* data() const { return _data.get(); }
+		[[nodiscard]] size_t size() const { return _size; }
+
+		T& operator[](size_t i) { return _data[i]; }
+		const T& operator[](size_t i) const { return _data[i]; }
+
+		std::span<T> span() { return { _data.get(), _size }; }
+		std::span<const T> span() const { return { _data.get(), _size }; }
+
+	private:
+		struct Deleter
+		{
+			void operator()(T* p) const { ::operator delete[](p, std::align_val_t{ Alignment }); }
+		};
+
+		static T* Allocate(size_t size)
+		{
+			if (size == 0)
+				return nullptr;
+
+			return static_cast<T*>(::operator new[](size * sizeof(T), std::align_val_t{ Alignment }));
+		}
+
+		std::unique_ptr<T[], Deleter> _data;
+		size_t _size = 0;
+	};
+}
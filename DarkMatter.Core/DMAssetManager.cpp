@@ -37,35 +37,36 @@ namespace dm::core
 		if (!queueLoad || IsTextureLoading(imageId))
 			return nullptr;
 
-		task::GTaskSystem->async_([this, imageId]()
-			{
-				// final sanity check before doing the upload. if a bunch of jobs were queued for the same texture upload, this will catch almost all of the duplicates.
-				if ((_textureStore.contains(imageId) && _textureStore[imageId] != nullptr) || !ExchangeTextureLoading(imageId, true))
-					return;
+		LoadImageAsync(imageId).Detach(nullptr, task::Priority::Background);
 
-				const auto asset = _currentRegistry->GetTexture(imageId);
-				const auto assetPath = asset.GetPath();
+		return nullptr;
+	}
 
-				if (!_fileSystem->FileExists(assetPath))
-				{
-					_log.error("File doesn't exist! " + assetPath);
-					return;
-				}
+	task::Task<> AssetManager::LoadImageAsync(uint32_t imageId)
+	{
+		// final sanity check before doing the upload. if a bunch of jobs were queued for the same texture upload, this will catch almost all of the duplicates.
+		if ((_textureStore.contains(imageId) && _textureStore[imageId] != nullptr) || !ExchangeTextureLoading(imageId, true))
+			co_return;
 
-				const auto fileSize = _fileSystem->FileSize(assetPath);
-				std::vector<char> buffer(fileSize);
-				_fileSystem->ReadFile(assetPath, buffer.data());
-				// ReSharper disable once CppTooWideScope // loading the image is thread safe, don't force a lock if we don't need to
-				const auto image = LoadImageToGPU(buffer.data(), buffer.size(), asset.GetFormat(), asset.GetExtent());
-				{
-					std::unique_lock lock(_rwLockTexture);
-					_textureStore[imageId] = image;
-				}
+		const auto asset = _currentRegistry->GetTexture(imageId);
+		const auto assetPath = asset.GetPath();
 
-				ExchangeTextureLoading(imageId, false);
-			}, std::make_shared<task::SyncCounter>());
+		// the read happens on an I/O thread, we're back on a worker by the time the upload starts
+		auto buffer = co_await task::ReadFileAsync(_fileSystem, assetPath, task::Priority::Background);
+		if (!buffer.has_value())
+		{
+			_log.error("File doesn't exist! " + assetPath);
+			co_return;
+		}
 
-		return nullptr;
+		// ReSharper disable once CppTooWideScope // loading the image is thread safe, don't force a lock if we don't need to
+		const auto image = LoadImageToGPU(buffer->data(), buffer->size(), asset.GetFormat(), asset.GetExtent());
+		{
+			std::unique_lock lock(_rwLockTexture);
+			_textureStore[imageId] = image;
+		}
+
+		ExchangeTextureLoading(imageId, false);
 	}
 
 	void AssetManager::TryUnloadMesh(uint32_t assetId)
@@ -77,7 +78,7 @@ namespace dm::core
 				{
 					_meshStore[assetId] = nullptr;
 				}
-			}, std::make_shared<task::SyncCounter>());
+			}, task::Priority::Background);
 	}
 
 	void AssetManager::TryUnloadImage(uint32_t imageId)
@@ -89,7 +90,7 @@ namespace dm::core
 				{
 					_textureStore[imageId] = nullptr;
 				}
-			}, std::make_shared<task::SyncCounter>());
+			}, task::Priority::Background);
 	}
 
 	std::shared_ptr<dm3d::Image> AssetManager::LoadImageToGPU(char* pData, size_t size, dm3d::ImageFormat format, dm3d::Extent3D extent) const
@@ -111,33 +112,34 @@ namespace dm::core
 		if (!queueLoad || IsMeshLoading(assetId))
 			return nullptr;
 
-		task::GTaskSystem->async_([this, assetId]()
-			{
-				if (!ExchangeMeshLoading(assetId, true))
-					return;
+		LoadMeshAsync(assetId).Detach(nullptr, task::Priority::Background);
 
-				auto asset = _currentRegistry->GetMesh(assetId);
-				auto assetPath = asset.GetPath();
+		return nullptr;
+	}
 
-				if (!_fileSystem->FileExists(assetPath))
-				{
-					_log.error("File doesn't exist! " + assetPath);
-					return;
-				}
+	task::Task<> AssetManager::LoadMeshAsync(uint32_t assetId)
+	{
+		if (!ExchangeMeshLoading(assetId, true))
+			co_return;
 
-				auto fileSize = _fileSystem->FileSize(assetPath);
-				std::vector<char> buffer(fileSize);
-				// ReSharper disable once CppTooWideScope // loading the mesh is thread safe, don't force a lock if we don't need to
-				auto mesh = ParseAndLoadMeshToGPU(buffer.data(), buffer.size());
-				{
-					std::unique_lock lock(_rwLockMesh);
-					_meshStore[assetId] = mesh;
-				}
+		const auto asset = _currentRegistry->GetMesh(assetId);
+		const auto assetPath = asset.GetPath();
 
-				ExchangeMeshLoading(assetId, false);
-			}, std::make_shared<task::SyncCounter>());
+		auto buffer = co_await task::ReadFileAsync(_fileSystem, assetPath, task::Priority::Background);
+		if (!buffer.has_value())
+		{
+			_log.error("File doesn't exist! " + assetPath);
+			co_return;
+		}
 
-		return nullptr;
+		// ReSharper disable once CppTooWideScope // loading the mesh is thread safe, don't force a lock if we don't need to
+		auto mesh = ParseAndLoadMeshToGPU(buffer->data(), buffer->size());
+		{
+			std::unique_lock lock(_rwLockMesh);
+			_meshStore[assetId] = mesh;
+		}
+
+		ExchangeMeshLoading(assetId, false);
 	}
 
 	bool AssetManager::IsTextureLoading(uint32_t id)
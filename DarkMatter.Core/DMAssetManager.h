@@ -7,6 +7,7 @@
 #include "DMFileSystem.h"
 #include "DMLogger.h"
 #include "DMMeshRenderable.h"
+#include "DMTaskCoroutine.h"
 
 namespace dm::core
 {
@@ -26,6 +27,8 @@ namespace dm::core
 		bool IsMeshLoading(uint32_t id);
 		bool ExchangeTextureLoading(uint32_t id, bool loading);
 		bool ExchangeMeshLoading(uint32_t id, bool loading);
+		task::Task<> LoadImageAsync(uint32_t imageId);
+		task::Task<> LoadMeshAsync(uint32_t assetId);
 		std::shared_ptr<MeshRenderable> ParseAndLoadMeshToGPU(char* pData, size_t size);
 		std::shared_ptr<dm3d::Image> LoadImageToGPU(char* pData, size_t size, dm3d::ImageFormat format, dm3d::Extent3D extent) const;
 
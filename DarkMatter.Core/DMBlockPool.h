@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace dm::core
+{
+	// number of blocks any BlockPool had to get from the heap, stops growing once the pools are warm
+	inline std::atomic<uint64_t> GBlockPoolHeapAllocations{ 0 };
+
+	// Fixed size block allocator. Each thread keeps a small free list and trades batches with a shared list, so blocks
+	// freed on a different thread than they were allocated on (jobs, counters) still find their way back. Blocks are never returned to the OS.
+	template <size_t BlockSize, size_t BatchSize = 64>
+	class BlockPool
+	{
+		static_assert(BlockSize >= sizeof(void*));
+
+	public:
+		static void* Allocate()
+		{
+			auto& cache = Cache();
+			if (cache.head == nullptr)
+			{
+				Refill(cache);
+			}
+
+			if (cache.head == nullptr)
+			{
+				++GBlockPoolHeapAllocations;
+				return ::operator new(BlockSize);
+			}
+
+			auto node = cache.head;
+			cache.head = node->next;
+			--cache.count;
+			return node;
+		}
+
+		static void Free(void* p)
+		{
+			auto& cache = Cache();
+			auto node = static_cast<Node*>(p);
+			node->next = cache.head;
+			cache.head = node;
+			++cache.count;
+
+			if (cache.count >= BatchSize * 2)
+			{
+				Spill(cache, BatchSize);
+			}
+		}
+
+	private:
+		struct Node
+		{
+			Node* next;
+		};
+
+		struct LocalCache
+		{
+			Node* head = nullptr;
+			size_t count = 0;
+
+			~LocalCache()
+			{
+				Spill(*this, count);
+			}
+		};
+
+		static LocalCache& Cache()
+		{
+			thread_local LocalCache cache;
+			return cache;
+		}
+
+		static void Refill(LocalCache& cache)
+		{
+			std::unique_lock lock(_globalLock);
+			while (_globalHead != nullptr && cache.count < BatchSize)
+			{
+				auto node = _globalHead;
+				_globalHead = node->next;
+				node->next = cache.head;
+				cache.head = node;
+				++cache.count;
+			}
+		}
+
+		static void Spill(LocalCache& cache, size_t count)
+		{
+			if (count == 0)
+				return;
+
+			// detach the first count nodes, then splice them onto the shared list in one go
+			auto first = cache.head;
+			auto last = first;
+			for (size_t i = 1; i < count; i++)
+			{
+				last = last->next;
+			}
+
+			cache.head = last->next;
+			cache.count -= count;
+
+			std::unique_lock lock(_globalLock);
+			last->next = _globalHead;
+			_globalHead = first;
+		}
+
+		inline static std::mutex _globalLock;
+		inline static Node* _globalHead = nullptr;
+	};
+
+	// std allocator over BlockPool, for std::allocate_shared
+	template <typename T>
+	struct PoolAllocator
+	{
+		static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+		using value_type = T;
+
+		PoolAllocator() = default;
+
+		template <typename U>
+		PoolAllocator(const PoolAllocator<U>&) {}
+
+		T* allocate(size_t n)
+		{
+			if (n != 1)
+				return static_cast<T*>(::operator new(n * sizeof(T)));
+
+			return static_cast<T*>(BlockPool<sizeof(T)>::Allocate());
+		}
+
+		void deallocate(T* p, size_t n)
+		{
+			if (n != 1)
+			{
+				::operator delete(p);
+				return;
+			}
+
+			BlockPool<sizeof(T)>::Free(p);
+		}
+
+		template <typename U>
+		bool operator==(const PoolAllocator<U>&) const { return true; }
+	};
+}
@@ -0,0 +1,39 @@
+#include "pch.h"
+#include "DMCpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace dm::core
+{
+	bool HasAvx2()
+	{
+		static const bool supported = []
+			{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+
+				// AVX also needs the OS to save the ymm registers on a context switch, OSXSAVE then XCR0 says whether it does
+				__cpuid(info, 1);
+				const bool osxsave = (info[2] & (1 << 27)) != 0;
+				const bool avx = (info[2] & (1 << 28)) != 0;
+				if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+					return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+				return __builtin_cpu_supports("avx2") != 0;
+#else
+				return false;
+#endif
+			}();
+
+		return supported;
+	}
+}
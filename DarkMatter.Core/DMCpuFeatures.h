@@ -0,0 +1,8 @@
+#pragma once
+
+namespace dm::core
+{
+	// true if both the CPU and the OS support AVX2, checked once. builds only turn AVX2 on for the files holding the
+	// kernels that need it, everything else picks those kernels at runtime with this
+	bool HasAvx2();
+}
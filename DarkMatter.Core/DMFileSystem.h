@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 namespace dm::core
@@ -18,6 +19,20 @@ namespace dm::core
 		};
 	}
 
+	// read only view of a whole file, valid until the object is destroyed
+	class MappedFile
+	{
+	public:
+		virtual ~MappedFile() = default;
+
+		const char* GetData() const { return _pData; }
+		size_t GetSize() const { return _size; }
+
+	protected:
+		const char* _pData = nullptr;
+		size_t _size = 0;
+	};
+
 	class FileSystem
 	{
 	public:
@@ -27,5 +42,7 @@ namespace dm::core
 		virtual void ReadFile(std::string path, char* pData) = 0;
 		virtual void WriteFile(std::string path, char* pData, size_t size, bool createNew = true) = 0;
 		virtual std::string ReadFileText(std::string path) = 0;
+		// the file's pages are read in as they're touched, nothing is copied up front
+		virtual std::unique_ptr<MappedFile> MapFile(std::string path) = 0;
 	};
 }
\ No newline at end of file
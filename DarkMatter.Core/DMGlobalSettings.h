@@ -1,4 +1,7 @@
 #pragma once
+#include <cstdint>
+
+#include "DMTaskSystemConfig.h"
 
 namespace dm::core
 {
@@ -6,6 +9,14 @@ namespace dm::core
 	{
 		bool IgnoreQuitEvents = false;
 		bool DebugDirectX = true;
+		// threads for blocking file reads, see IOExecutor
+		uint32_t IOThreadCount = 2;
+		// paged terrain, see PagedHeightMap. a page is one 64 * 64 height tile of terrain.dmt and the budget counts loads
+		// in flight. 4096 float pages with their normals are 96MB, terrain files with no more tiles than that load whole.
+		// the radius is the editor camera's far plane
+		float TerrainPageRadius = 6000.f;
+		uint32_t TerrainResidentPages = 4096;
+		task::TaskSystemConfig TaskSystem;
 	};
 
 	extern GlobalSettings GSettings;
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+namespace dm::core
+{
+	// Non-owning 2D view over row major data, x is the column and z the row. stride is the distance between rows in
+	// elements, so a view can cover a sub-rectangle of a bigger grid. A stand-in for std::mdspan until we're on C++23.
+	template <typename T>
+	struct GridView
+	{
+		T* data = nullptr;
+		size_t width = 0;
+		size_t height = 0;
+		size_t stride = 0;
+
+		GridView() = default;
+		GridView(T* pData, size_t w, size_t h, size_t s) : data(pData), width(w), height(h), stride(s) {}
+		GridView(T* pData, size_t w, size_t h) : GridView(pData, w, h, w) {}
+
+		// a view of T converts to a view of const T
+		template <typename U> requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+		GridView(const GridView<U>& other) : GridView(other.data, other.width, other.height, other.stride) {}
+
+		T& operator()(size_t x, size_t z) const { return data[z * stride + x]; }
+		[[nodiscard]] std::span<T> Row(size_t z) const { return { data + z * stride, width }; }
+
+		[[nodiscard]] bool IsContiguous() const { return stride == width; }
+		// only valid when IsContiguous()
+		[[nodiscard]] std::span<T> Flat() const { return { data, width * height }; }
+
+		[[nodiscard]] GridView SubView(size_t x, size_t z, size_t w, size_t h) const { return GridView(data + z * stride + x, w, h, stride); }
+	};
+}
@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "DMIOExecutor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "DMThreadTopology.h"
+
+dm::core::task::IOExecutor* dm::core::task::GIOExecutor;
+
+namespace dm::core::task
+{
+	IOExecutor::IOExecutor(uint32_t threadCount)
+	{
+		threadCount = std::max(threadCount, 1u);
+		for (uint32_t i = 0; i != threadCount; i++)
+		{
+			_threads.emplace_back([&, i] { Run(i); });
+		}
+	}
+
+	IOExecutor::~IOExecutor()
+	{
+		_done = true;
+		_pending.release(static_cast<std::ptrdiff_t>(_threads.size()));
+
+		for (auto& t : _threads)
+		{
+			t.join();
+		}
+	}
+
+	IOExecutorStats IOExecutor::GetStats() const
+	{
+		return IOExecutorStats{ .requests = _executed.load(), .bytesRead = _bytesRead.load(), .ioNanoseconds = _ioNanoseconds.load() };
+	}
+
+	void IOExecutor::Run(const uint32_t i)
+	{
+		SetCurrentThreadName("IO Thread " + std::to_string(i));
+
+		while (true)
+		{
+			_pending.acquire();
+
+			// the queue can briefly look empty to us even though our request has been enqueued, so retry until
+			// it shows up. Only the shutdown release comes without a request
+			InlineFunction<64> request;
+			while (!_requests.try_dequeue(request) && !_done)
+			{
+				std::this_thread::yield();
+			}
+
+			if (!request)
+				break;
+
+			const auto start = std::chrono::steady_clock::now();
+			request();
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+
+			_ioNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+			++_executed;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <semaphore>
+#include <thread>
+#include <vector>
+#include "DMInlineFunction.h"
+#include "concurrentqueue.h"
+
+namespace dm::core::task
+{
+	struct IOExecutorStats
+	{
+		uint64_t requests;
+		uint64_t bytesRead;
+		// time the I/O threads spent inside requests, mostly blocked on the disk
+		uint64_t ioNanoseconds;
+	};
+
+	// Small pool of threads for blocking file access, kept apart from the TaskSystem workers so a slow disk
+	// only stalls these threads. Requests should do the read and hand the data back to the task system for anything CPU heavy.
+	class IOExecutor
+	{
+	public:
+		explicit IOExecutor(uint32_t threadCount);
+		~IOExecutor();
+
+		IOExecutor(const IOExecutor& other) = delete;
+
+		template <typename F>
+		void Submit(F&& f)
+		{
+			_requests.enqueue(InlineFunction<64>(std::forward<F>(f)));
+			_pending.release();
+		}
+
+		void AddBytesRead(uint64_t bytes) { _bytesRead += bytes; }
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(_threads.size()); }
+		IOExecutorStats GetStats() const;
+
+	private:
+		std::vector<std::thread> _threads;
+		moodycamel::ConcurrentQueue<InlineFunction<64>> _requests;
+		std::counting_semaphore<> _pending{ 0 };
+		std::atomic<bool> _done{ false };
+
+		std::atomic<uint64_t> _executed{ 0 };
+		std::atomic<uint64_t> _bytesRead{ 0 };
+		std::atomic<uint64_t> _ioNanoseconds{ 0 };
+
+		void Run(uint32_t i);
+	};
+
+	extern IOExecutor* GIOExecutor;
+}
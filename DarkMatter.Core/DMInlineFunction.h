@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dm::core
+{
+	// Move-only void() callable that stores captures up to Capacity bytes inline. Bigger callables fall back to the heap.
+	template <size_t Capacity>
+	class InlineFunction
+	{
+	public:
+		InlineFunction() = default;
+
+		template <typename F> requires (!std::is_same_v<std::decay_t<F>, InlineFunction> && std::is_invocable_v<std::decay_t<F>&>)
+		InlineFunction(F&& f)
+		{
+			using Fn = std::decay_t<F>;
+
+			if constexpr (FitsInline<Fn>)
+			{
+				new (_storage) Fn(std::forward<F>(f));
+				_ops = &InlineOps<Fn>;
+			}
+			else
+			{
+				*reinterpret_cast<Fn**>(_storage) = new Fn(std::forward<F>(f));
+				_ops = &HeapOps<Fn>;
+			}
+		}
+
+		InlineFunction(InlineFunction&& other) noexcept
+		{
+			MoveFrom(other);
+		}
+
+		InlineFunction& operator=(InlineFunction&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				MoveFrom(other);
+			}
+
+			return *this;
+		}
+
+		InlineFunction(const InlineFunction& other) = delete;
+		InlineFunction& operator=(const InlineFunction& other) = delete;
+
+		~InlineFunction()
+		{
+			Reset();
+		}
+
+		void operator()()
+		{
+			_ops->invoke(_storage);
+		}
+
+		explicit operator bool() const { return _ops != nullptr; }
+
+		void Reset()
+		{
+			if (_ops != nullptr)
+			{
+				_ops->destroy(_storage);
+				_ops = nullptr;
+			}
+		}
+
+	private:
+		struct Ops
+		{
+			void (*invoke)(void* storage);
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void* storage);
+		};
+
+		template <typename Fn>
+		static constexpr bool FitsInline = sizeof(Fn) <= Capacity && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Fn>;
+
+		template <typename Fn>
+		static constexpr Ops InlineOps = {
+			[](void* storage) { (*static_cast<Fn*>(storage))(); },
+			[](void* dst, void* src) { new (dst) Fn(std::move(*static_cast<Fn*>(src))); static_cast<Fn*>(src)->~Fn(); },
+			[](void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+		};
+
+		template <typename Fn>
+		static constexpr Ops HeapOps = {
+			[](void* storage) { (**static_cast<Fn**>(storage))(); },
+			[](void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); },
+			[](void* storage) { delete *static_cast<Fn**>(storage); }
+		};
+
+		void MoveFrom(InlineFunction& other)
+		{
+			if (other._ops != nullptr)
+			{
+				other._ops->move(_storage, other._storage);
+				_ops = std::exchange(other._ops, nullptr);
+			}
+		}
+
+		alignas(std::max_align_t) std::byte _storage[Capacity];
+		const Ops* _ops = nullptr;
+	};
+}
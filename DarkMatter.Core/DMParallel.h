@@ -0,0 +1,133 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "DMTaskSystem.h"
+
+namespace dm::core::task
+{
+	struct Range
+	{
+		size_t begin;
+		size_t end;
+
+		[[nodiscard]] size_t size() const { return end - begin; }
+	};
+
+	namespace detail
+	{
+		struct ParallelForState
+		{
+			Range range;
+			size_t chunkSize;
+			size_t numChunks;
+			std::atomic<size_t> nextChunk{ 0 };
+			SyncCounter remaining;
+			void* fn;
+			void (*invoke)(void* fn, size_t chunk, Range range);
+
+			// claims and runs chunks until none are left, returns once this thread can't help any more
+			void RunChunks()
+			{
+				while (true)
+				{
+					const auto chunk = nextChunk.fetch_add(1);
+					if (chunk >= numChunks)
+						return;
+
+					const auto begin = range.begin + chunk * chunkSize;
+					invoke(fn, chunk, Range{ .begin = begin, .end = std::min(begin + chunkSize, range.end) });
+
+					remaining.Decrement();
+				}
+			}
+		};
+
+		struct ChunkPlan
+		{
+			size_t chunkSize;
+			size_t numChunks;
+		};
+
+		inline ChunkPlan PlanChunks(Range range, size_t grain)
+		{
+			if (range.end <= range.begin)
+				return ChunkPlan{ .chunkSize = 0, .numChunks = 0 };
+
+			const auto count = range.size();
+			grain = std::max<size_t>(grain, 1);
+
+			// aim for a few chunks per thread so uneven chunks even out, but never go below the grain
+			const size_t threads = GTaskSystem != nullptr ? GTaskSystem->GetWorkerCount() + 1 : 1;
+			const auto chunkSize = std::max(grain, (count + threads * 4 - 1) / (threads * 4));
+			return ChunkPlan{ .chunkSize = chunkSize, .numChunks = (count + chunkSize - 1) / chunkSize };
+		}
+
+		template <typename F>
+		void ParallelChunks(Range range, ChunkPlan plan, F& fn)
+		{
+			const auto [chunkSize, numChunks] = plan;
+			if (numChunks == 0)
+				return;
+
+			if (numChunks == 1 || GTaskSystem == nullptr)
+			{
+				for (size_t chunk = 0; chunk < numChunks; chunk++)
+				{
+					const auto begin = range.begin + chunk * chunkSize;
+					fn(chunk, Range{ .begin = begin, .end = std::min(begin + chunkSize, range.end) });
+				}
+				return;
+			}
+
+			auto state = std::allocate_shared<ParallelForState>(PoolAllocator<ParallelForState>());
+			state->range = range;
+			state->chunkSize = chunkSize;
+			state->numChunks = numChunks;
+			state->remaining.Increment(static_cast<uint32_t>(numChunks));
+			state->fn = &fn;
+			state->invoke = [](void* f, size_t chunk, Range r) { (*static_cast<F*>(f))(chunk, r); };
+
+			// helpers that start after every chunk is claimed just drop their reference to the state.
+			// the caller is blocked on them, so they go in the critical lane
+			const auto helpers = std::min<size_t>(numChunks - 1, GTaskSystem->GetWorkerCount());
+			GTaskSystem->SubmitBatch(helpers, [&state](size_t) { return [state] { state->RunChunks(); }; }, nullptr, Priority::Critical);
+
+			state->RunChunks();
+			GTaskSystem->WaitFor(state->remaining);
+		}
+	}
+
+	// Runs fn(Range) over chunks of [range.begin, range.end) of at least grain elements. The calling thread works on
+	// chunks too, then helps with other queued jobs until every chunk has run.
+	template <typename F>
+	void parallel_for(Range range, size_t grain, F&& fn)
+	{
+		auto chunkFn = [&fn](size_t, Range chunk) { fn(chunk); };
+		detail::ParallelChunks(range, detail::PlanChunks(range, grain), chunkFn);
+	}
+
+	// Maps each chunk to a T with map(Range) and folds the results in chunk order with combine(T, T), so the result doesn't depend on scheduling.
+	template <typename T, typename Map, typename Combine>
+	T parallel_reduce(Range range, size_t grain, T identity, Map&& map, Combine&& combine)
+	{
+		const auto plan = detail::PlanChunks(range, grain);
+		std::vector<T> partials(plan.numChunks, identity);
+		auto chunkFn = [&](size_t chunk, Range r)
+			{
+				partials[chunk] = map(r);
+			};
+
+		detail::ParallelChunks(range, plan, chunkFn);
+
+		T result = identity;
+		for (auto& partial : partials)
+		{
+			result = combine(result, partial);
+		}
+
+		return result;
+	}
+}
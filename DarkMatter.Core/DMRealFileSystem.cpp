@@ -4,8 +4,104 @@
 #include <filesystem>
 #include <fstream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace dm::core
 {
+	namespace
+	{
+#ifdef _WIN32
+		class RealMappedFile : public MappedFile
+		{
+		public:
+			explicit RealMappedFile(const std::filesystem::path& path)
+			{
+				_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (_file == INVALID_HANDLE_VALUE)
+					throw std::runtime_error("Failed to open file for mapping: " + path.string());
+
+				LARGE_INTEGER size;
+				GetFileSizeEx(_file, &size);
+				_size = static_cast<size_t>(size.QuadPart);
+
+				// an empty file can't be mapped, it's just an empty view
+				if (_size == 0)
+					return;
+
+				_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (_mapping != nullptr)
+				{
+					_pData = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+				}
+
+				if (_pData == nullptr)
+				{
+					Release();
+					throw std::runtime_error("Failed to map file: " + path.string());
+				}
+			}
+
+			~RealMappedFile() override
+			{
+				Release();
+			}
+
+		private:
+			void Release()
+			{
+				if (_pData != nullptr)
+					UnmapViewOfFile(_pData);
+				if (_mapping != nullptr)
+					CloseHandle(_mapping);
+				CloseHandle(_file);
+			}
+
+			HANDLE _file = INVALID_HANDLE_VALUE;
+			HANDLE _mapping = nullptr;
+		};
+#else
+		class RealMappedFile : public MappedFile
+		{
+		public:
+			explicit RealMappedFile(const std::filesystem::path& path)
+			{
+				const int file = open(path.c_str(), O_RDONLY);
+				if (file < 0)
+					throw std::runtime_error("Failed to open file for mapping: " + path.string());
+
+				_size = static_cast<size_t>(lseek(file, 0, SEEK_END));
+				if (_size != 0)
+				{
+					void* pMapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+					if (pMapped != MAP_FAILED)
+					{
+						madvise(pMapped, _size, MADV_SEQUENTIAL);
+						_pData = static_cast<const char*>(pMapped);
+					}
+				}
+
+				// the mapping keeps the file alive on its own
+				close(file);
+				if (_size != 0 && _pData == nullptr)
+					throw std::runtime_error("Failed to map file: " + path.string());
+			}
+
+			~RealMappedFile() override
+			{
+				if (_pData != nullptr)
+					munmap(const_cast<char*>(_pData), _size);
+			}
+		};
+#endif
+	}
+
 	void RealFileSystem::Mount(std::string folderPath)
 	{
 		std::filesystem::path mountPath(folderPath);
@@ -89,4 +185,10 @@ namespace dm::core
 		return ss.str();
 	}
 
+	std::unique_ptr<MappedFile> RealFileSystem::MapFile(std::string path)
+	{
+		std::filesystem::path fullPath = std::filesystem::path(_mountedFolder) / path;
+		return std::make_unique<RealMappedFile>(fullPath);
+	}
+
 }
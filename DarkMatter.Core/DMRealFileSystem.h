@@ -14,6 +14,7 @@ namespace dm::core
 		void ReadFile(std::string path, char* pData) override;
 		void WriteFile(std::string path, char* pData, size_t size, bool createNew = true) override;
 		std::string ReadFileText(std::string path) override;
+		std::unique_ptr<MappedFile> MapFile(std::string path) override;
 	private:
 		std::string _mountedFolder;
 	};
@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "DMSyncCounter.h"
+
+#include "DMTaskSystem.h"
+
+namespace dm::core::task
+{
+	void SyncCounter::Decrement()
+	{
+		if (--_internalCounter != 0)
+			return;
+
+		Job* released;
+		{
+			std::unique_lock lock(_waitLock);
+			released = std::exchange(_waiters, nullptr);
+		}
+
+		_internalCounter.notify_all();
+
+		if (released != nullptr)
+		{
+			GTaskSystem->Resume(released);
+		}
+		else if (GTaskSystem != nullptr)
+		{
+			// Resume wakes WaitFor threads along with the work it queues, otherwise they still need to see the zero
+			GTaskSystem->WakeHelpers();
+		}
+	}
+
+	void SyncCounter::Wait() const
+	{
+		// only the final Decrement notifies, intermediate values just go back to sleep
+		for (auto value = _internalCounter.load(); value != 0; value = _internalCounter.load())
+		{
+			_internalCounter.wait(value);
+		}
+	}
+
+	bool SyncCounter::TryPark(Job* job)
+	{
+		std::unique_lock lock(_waitLock);
+
+		// checked under the lock, Decrement takes the same lock before draining so a job can't be parked after the drain
+		if (IsZero())
+			return false;
+
+		job->next = _waiters;
+		_waiters = job;
+		return true;
+	}
+}
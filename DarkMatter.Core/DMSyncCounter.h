@@ -2,9 +2,14 @@
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+
+#include "DMBlockPool.h"
 
 namespace dm::core::task
 {
+	struct Job;
+
 	class SyncCounter
 	{
 	public:
@@ -12,22 +17,34 @@ namespace dm::core::task
 
 		SyncCounter(const SyncCounter& other) = delete;
 
-		void Increment()
+		void Increment(uint32_t count = 1)
 		{
-			++_internalCounter;
+			_internalCounter += count;
 		}
 
-		void Decrement()
-		{
-			--_internalCounter;
-		}
+		// releases every job parked on this counter when it reaches zero
+		void Decrement();
+
+		// blocks the calling thread until the counter reaches zero, see TaskSystem::WaitFor for a waiting thread that helps instead
+		void Wait() const;
 
 		[[nodiscard]] bool IsZero() const
 		{
 			return _internalCounter.load() == 0;
 		}
 
+		// parks the job until the counter reaches zero, returns false if it already is and the caller should run the job itself
+		bool TryPark(Job* job);
+
 	private:
-		std::atomic<uint32_t> _internalCounter;
+		std::atomic<uint32_t> _internalCounter{ 0 };
+		std::mutex _waitLock;
+		Job* _waiters = nullptr;
 	};
+
+	// counters come out of a pool, so making one per task doesn't hit the heap once the pool is warm
+	inline std::shared_ptr<SyncCounter> MakeSyncCounter()
+	{
+		return std::allocate_shared<SyncCounter>(PoolAllocator<SyncCounter>());
+	}
 }
@@ -0,0 +1,270 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DMFileSystem.h"
+#include "DMIOExecutor.h"
+#include "DMTaskSystem.h"
+
+namespace dm::core::task
+{
+	template <typename T = void>
+	class Task;
+
+	namespace detail
+	{
+		struct TaskPromiseBase
+		{
+			struct FinalAwaiter
+			{
+				bool await_ready() const noexcept { return false; }
+
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+				{
+					auto& promise = h.promise();
+
+					if (promise.continuation)
+					{
+						return promise.continuation;
+					}
+
+					if (promise.detached)
+					{
+						// same as an exception escaping a plain job
+						if (promise.exception)
+						{
+							std::terminate();
+						}
+
+						auto signal = std::move(promise.signal);
+						h.destroy();
+
+						if (signal != nullptr)
+						{
+							signal->Decrement();
+						}
+					}
+
+					return std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter final_suspend() noexcept { return {}; }
+			void unhandled_exception() { exception = std::current_exception(); }
+
+			std::coroutine_handle<> continuation;
+			std::exception_ptr exception;
+			std::shared_ptr<SyncCounter> signal;
+			bool detached = false;
+		};
+
+		template <typename T>
+		struct TaskPromise : TaskPromiseBase
+		{
+			Task<T> get_return_object();
+
+			template <typename U>
+			void return_value(U&& value) { result.emplace(std::forward<U>(value)); }
+
+			T TakeResult()
+			{
+				if (exception)
+					std::rethrow_exception(exception);
+
+				return std::move(*result);
+			}
+
+			std::optional<T> result;
+		};
+
+		template <>
+		struct TaskPromise<void> : TaskPromiseBase
+		{
+			Task<void> get_return_object();
+
+			void return_void() {}
+
+			void TakeResult()
+			{
+				if (exception)
+					std::rethrow_exception(exception);
+			}
+		};
+	}
+
+	// Lazily started coroutine. Either co_await it from another Task, which runs it inline and resumes the awaiter when it's done,
+	// or Detach() it to run it on the task system on its own.
+	template <typename T>
+	class [[nodiscard]] Task
+	{
+	public:
+		using promise_type = detail::TaskPromise<T>;
+
+		Task() = default;
+		explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+		Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (_handle)
+					_handle.destroy();
+				_handle = std::exchange(other._handle, nullptr);
+			}
+
+			return *this;
+		}
+
+		Task(const Task& other) = delete;
+		Task& operator=(const Task& other) = delete;
+
+		~Task()
+		{
+			if (_handle)
+				_handle.destroy();
+		}
+
+		// Starts the task on the task system. The frame frees itself when it finishes, and signal (if any) is decremented then.
+		void Detach(std::shared_ptr<SyncCounter> signal = nullptr, Priority priority = Priority::Normal)
+		{
+			auto handle = std::exchange(_handle, nullptr);
+			handle.promise().detached = true;
+
+			if (signal != nullptr)
+			{
+				signal->Increment();
+				handle.promise().signal = std::move(signal);
+			}
+
+			GTaskSystem->async_([handle] { handle.resume(); }, priority);
+		}
+
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+				std::coroutine_handle<promise_type> handle;
+
+				bool await_ready() const noexcept { return false; }
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					handle.promise().continuation = awaiting;
+					return handle;
+				}
+
+				T await_resume() { return handle.promise().TakeResult(); }
+			};
+
+			return Awaiter{ _handle };
+		}
+
+	private:
+		std::coroutine_handle<promise_type> _handle;
+	};
+
+	namespace detail
+	{
+		template <typename T>
+		Task<T> TaskPromise<T>::get_return_object()
+		{
+			return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+		}
+
+		inline Task<void> TaskPromise<void>::get_return_object()
+		{
+			return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+		}
+	}
+
+	// co_await Schedule() moves the rest of the coroutine onto a worker
+	inline auto Schedule(Priority priority = Priority::Normal)
+	{
+		struct Awaiter
+		{
+			Priority priority;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> h) const { GTaskSystem->async_([h] { h.resume(); }, priority); }
+			void await_resume() const noexcept {}
+		};
+
+		return Awaiter{ priority };
+	}
+
+	// co_await WhenZero(counter) parks the coroutine on the counter, no worker is held while it waits
+	inline auto WhenZero(std::shared_ptr<SyncCounter> counter, Priority priority = Priority::Normal)
+	{
+		struct Awaiter
+		{
+			std::shared_ptr<SyncCounter> counter;
+			Priority priority;
+
+			bool await_ready() const noexcept { return counter->IsZero(); }
+			void await_suspend(std::coroutine_handle<> h) const { GTaskSystem->async_([h] { h.resume(); }, counter, priority); }
+			void await_resume() const noexcept {}
+		};
+
+		return Awaiter{ std::move(counter), priority };
+	}
+
+	// co_await ReadFileAsync(fs, path) does the read on an IOExecutor thread, then resumes the coroutine on a worker in the given lane.
+	// nullopt if the file doesn't exist
+	inline auto ReadFileAsync(FileSystem* fileSystem, std::string path, Priority priority = Priority::Normal)
+	{
+		struct Awaiter
+		{
+			FileSystem* fileSystem;
+			std::string path;
+			Priority priority;
+			std::optional<std::vector<char>> data;
+			std::exception_ptr exception;
+
+			bool await_ready() const noexcept { return false; }
+
+			void await_suspend(std::coroutine_handle<> h)
+			{
+				GIOExecutor->Submit([this, h]
+					{
+						try
+						{
+							if (fileSystem->FileExists(path))
+							{
+								data.emplace(fileSystem->FileSize(path));
+								fileSystem->ReadFile(path, data->data());
+								GIOExecutor->AddBytesRead(data->size());
+							}
+						}
+						catch (...)
+						{
+							exception = std::current_exception();
+						}
+
+						// whatever the caller does with the data is CPU work, it doesn't belong on an I/O thread
+						GTaskSystem->async_([h] { h.resume(); }, priority);
+					});
+			}
+
+			std::optional<std::vector<char>> await_resume()
+			{
+				if (exception)
+					std::rethrow_exception(exception);
+
+				return std::move(data);
+			}
+		};
+
+		return Awaiter{ .fileSystem = fileSystem, .path = std::move(path), .priority = priority };
+	}
+}
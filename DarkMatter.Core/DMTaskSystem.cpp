@@ -1,4 +1,440 @@
 #include "pch.h"
 #include "DMTaskSystem.h"
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include "DMThreadTopology.h"
+
 dm::core::task::TaskSystem* dm::core::task::GTaskSystem;
+
+namespace dm::core::task
+{
+	namespace
+	{
+		// index of the worker owning the current thread, UINT32_MAX for external threads
+		thread_local uint32_t tWorkerIndex = UINT32_MAX;
+		thread_local TaskSystem* tWorkerOwner = nullptr;
+
+		uint32_t NextVictimSeed()
+		{
+			// xorshift, only needs to spread steal attempts across victims
+			thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	}
+
+	TaskSystem::TaskSystem(const TaskSystemConfig& config)
+	{
+		Configure(config);
+
+		for (uint32_t i = 0; i != _count; i++)
+		{
+			_threads.emplace_back([&, i] { Run(i); });
+		}
+	}
+
+	TaskSystem::~TaskSystem()
+	{
+		_done = true;
+		++_epoch;
+		_epoch.notify_all();
+
+		for (auto& t : _threads)
+		{
+			t.join();
+		}
+
+		for (auto& node : _nodes)
+		{
+			for (auto& queue : node->lanes)
+			{
+				Job* leftover;
+				while (queue.try_dequeue(leftover))
+				{
+					delete leftover;
+				}
+			}
+		}
+
+		// the workers are gone, so their deques can be popped from here
+		for (auto& worker : _workers)
+		{
+			for (auto& deque : worker->deques)
+			{
+				while (Job* leftover = deque.Pop())
+				{
+					delete leftover;
+				}
+			}
+		}
+	}
+
+	void TaskSystem::Configure(const TaskSystemConfig& config)
+	{
+		auto cpus = QueryCpuTopology();
+		const auto available = cpus.empty() ? std::max(std::thread::hardware_concurrency(), 1u) : static_cast<uint32_t>(cpus.size());
+
+		_count = config.workerCount != 0 ? config.workerCount : std::max(available, config.reservedCores + 1) - config.reservedCores;
+
+		// first logical processor of every core, then the second, and so on, so workers spread across physical cores before sharing one
+		std::map<uint32_t, uint32_t> siblingsSeen;
+		std::vector<std::pair<uint32_t, LogicalCpu>> ranked;
+		for (const auto& cpu : cpus)
+		{
+			ranked.emplace_back(siblingsSeen[cpu.core]++, cpu);
+		}
+		std::ranges::stable_sort(ranked, {}, &std::pair<uint32_t, LogicalCpu>::first);
+
+		// compact the OS node ids, they don't have to be contiguous
+		std::map<uint32_t, uint32_t> nodeIds;
+		const bool pinned = config.pinning != PinningPolicy::None && !ranked.empty();
+		if (pinned && config.perNodeQueues)
+		{
+			for (const auto& cpu : cpus)
+			{
+				nodeIds.emplace(cpu.node, static_cast<uint32_t>(nodeIds.size()));
+			}
+
+			for (const auto& cpu : cpus)
+			{
+				_cpuNode.resize(std::max<size_t>(_cpuNode.size(), cpu.index + 1), 0);
+				_cpuNode[cpu.index] = nodeIds[cpu.node];
+			}
+		}
+
+		for (size_t n = 0; n < std::max<size_t>(nodeIds.size(), 1); n++)
+		{
+			_nodes.push_back(std::make_unique<NodeQueues>());
+		}
+
+		_workers.reserve(_count);
+		for (uint32_t i = 0; i != _count; i++)
+		{
+			auto worker = std::make_unique<Worker>();
+
+			if (pinned)
+			{
+				// more workers than processors just wraps around
+				const auto& home = ranked[i % ranked.size()].second;
+				worker->node = nodeIds.empty() ? 0 : nodeIds[home.node];
+
+				if (config.pinning == PinningPolicy::Core)
+				{
+					worker->affinity.push_back(home.index);
+				}
+				else
+				{
+					for (const auto& cpu : cpus)
+					{
+						if (cpu.node == home.node)
+							worker->affinity.push_back(cpu.index);
+					}
+				}
+			}
+
+			_workers.push_back(std::move(worker));
+		}
+	}
+
+	uint32_t TaskSystem::CurrentNode() const
+	{
+		if (tWorkerOwner == this)
+			return _workers[tWorkerIndex]->node;
+
+		if (_nodes.size() == 1)
+			return 0;
+
+		const auto cpu = GetCurrentCpu();
+		return cpu < _cpuNode.size() ? _cpuNode[cpu] : 0;
+	}
+
+	TaskSystemStats TaskSystem::GetStats() const
+	{
+		return TaskSystemStats{ .executed = _executed.load(), .stolen = _stolen.load(), .injected = _injected.load(), .parked = _parked.load(), .helped = _helped.load(), .busyNanoseconds = _busyNanoseconds.load(), .poolHeapAllocations = GBlockPoolHeapAllocations.load() };
+	}
+
+	void TaskSystem::Submit(Job* job)
+	{
+		// blocked jobs wait on their counter instead of cycling through the queues
+		if (job->dependency != nullptr && job->dependency->TryPark(job))
+		{
+			++_parked;
+			return;
+		}
+
+		Push(job);
+		Wake();
+	}
+
+	void TaskSystem::Resume(Job* jobs)
+	{
+		uint32_t count = 0;
+		while (jobs != nullptr)
+		{
+			auto next = std::exchange(jobs->next, nullptr);
+			Push(jobs);
+			jobs = next;
+			++count;
+		}
+
+		Wake(count);
+	}
+
+	void TaskSystem::WaitFor(SyncCounter& counter)
+	{
+		const bool isWorker = tWorkerOwner == this;
+
+		while (!counter.IsZero())
+		{
+			Job* job = isWorker ? FindJob(tWorkerIndex) : FindJobExternal();
+			if (job == nullptr)
+			{
+				// nothing to pick up right now, but a parked dependency or an injected job can release the very work we wait
+				// on later. sleep until new work is queued or a counter reaches zero and look again, same announce and
+				// recheck as an idle worker
+				const auto epoch = _helpEpoch.load();
+				++_helping;
+				job = isWorker ? FindJob(tWorkerIndex) : FindJobExternal();
+				if (job == nullptr && !counter.IsZero())
+				{
+					_helpEpoch.wait(epoch);
+				}
+				--_helping;
+
+				if (job == nullptr)
+					continue;
+			}
+
+			if (!isWorker)
+			{
+				++_helped;
+			}
+
+			Execute(job);
+		}
+	}
+
+	void TaskSystem::Push(Job* job)
+	{
+		const auto lane = static_cast<size_t>(job->priority);
+		++_depth[lane];
+
+		if (tWorkerOwner == this)
+		{
+			_workers[tWorkerIndex]->deques[lane].Push(job);
+		}
+		else
+		{
+			_nodes[CurrentNode()]->lanes[lane].enqueue(job);
+			++_injected;
+		}
+	}
+
+	void TaskSystem::PushBatch(std::span<Job*> jobs, Priority priority)
+	{
+		const auto lane = static_cast<size_t>(priority);
+		_depth[lane] += static_cast<int64_t>(jobs.size());
+
+		if (tWorkerOwner == this)
+		{
+			// idle workers steal from here, pushing locally keeps the batch off the shared queues entirely
+			auto& deque = _workers[tWorkerIndex]->deques[lane];
+			for (auto job : jobs)
+			{
+				deque.Push(job);
+			}
+		}
+		else
+		{
+			_nodes[CurrentNode()]->lanes[lane].enqueue_bulk(jobs.data(), jobs.size());
+			_injected += jobs.size();
+		}
+	}
+
+	void TaskSystem::WakeHelpers()
+	{
+		if (_helping.load() == 0)
+			return;
+
+		++_helpEpoch;
+		_helpEpoch.notify_all();
+	}
+
+	void TaskSystem::Wake(const uint32_t count)
+	{
+		// threads in WaitFor may not be able to take the new work, they all wake and look so none is missed
+		WakeHelpers();
+
+		++_epoch;
+		const auto sleeping = _sleeping.load();
+		if (sleeping == 0)
+			return;
+
+		if (count >= sleeping)
+		{
+			_epoch.notify_all();
+			return;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			_epoch.notify_one();
+		}
+	}
+
+	Job* TaskSystem::FindJob(const uint32_t i)
+	{
+		constexpr auto background = static_cast<size_t>(Priority::Background);
+		auto& worker = *_workers[i];
+
+		// let one background job through if they've been waiting behind a long run of higher priority work
+		if (worker.sinceBackground >= _backgroundStarvationLimit && _depth[background].load() > 0)
+		{
+			if (Job* job = FindJobInLane(i, background))
+			{
+				worker.sinceBackground = 0;
+				return job;
+			}
+		}
+
+		for (size_t lane = 0; lane < _laneCount; lane++)
+		{
+			if (Job* job = FindJobInLane(i, lane))
+			{
+				worker.sinceBackground = lane == background ? 0 : worker.sinceBackground + 1;
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	Job* TaskSystem::FindJobInLane(const uint32_t i, const size_t lane)
+	{
+		if (_depth[lane].load(std::memory_order_relaxed) <= 0)
+			return nullptr;
+
+		Job* job = i < _count ? _workers[i]->deques[lane].Pop() : nullptr;
+
+		if (job == nullptr)
+		{
+			// own node's queue first, then the others
+			const auto home = CurrentNode();
+			const auto nodeCount = static_cast<uint32_t>(_nodes.size());
+			for (uint32_t n = 0; n != nodeCount && job == nullptr; ++n)
+			{
+				_nodes[(home + n) % nodeCount]->lanes[lane].try_dequeue(job);
+			}
+		}
+
+		if (job == nullptr)
+		{
+			// random victim, then walk the rest so a single busy worker can't hide its queue
+			const auto start = NextVictimSeed() % _count;
+			for (uint32_t n = 0; n != _count && job == nullptr; ++n)
+			{
+				const auto victim = (start + n) % _count;
+				if (victim == i)
+					continue;
+
+				if (job = _workers[victim]->deques[lane].Steal(); job != nullptr)
+				{
+					++_stolen;
+				}
+			}
+		}
+
+		if (job != nullptr)
+		{
+			--_depth[lane];
+		}
+
+		return job;
+	}
+
+	Job* TaskSystem::FindJobExternal()
+	{
+		for (size_t lane = 0; lane < static_cast<size_t>(Priority::Background); lane++)
+		{
+			if (Job* job = FindJobInLane(UINT32_MAX, lane))
+			{
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void TaskSystem::Execute(Job* job)
+	{
+		// the counter may have been raised again since the job was released
+		if (job->dependency != nullptr && job->dependency->TryPark(job))
+		{
+			++_parked;
+			return;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		job->func();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		_busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		++_executed;
+
+		auto signal = std::move(job->signal);
+		delete job;
+
+		if (signal != nullptr)
+		{
+			signal->Decrement();
+		}
+	}
+
+	void TaskSystem::Run(const uint32_t i)
+	{
+		tWorkerIndex = i;
+		tWorkerOwner = this;
+
+		const auto threadName = "Worker Thread " + std::to_string(i);
+		SetCurrentThreadName(threadName);
+		//tracy::SetThreadName(threadName.c_str());
+
+		if (!_workers[i]->affinity.empty())
+		{
+			PinCurrentThread(_workers[i]->affinity);
+		}
+
+		while (true)
+		{
+			if (Job* job = FindJob(i))
+			{
+				Execute(job);
+				continue;
+			}
+
+			// announce we're going idle, then look once more so a submit racing with us isn't missed
+			const auto epoch = _epoch.load();
+			++_sleeping;
+			Job* job = FindJob(i);
+			if (job == nullptr && !_done)
+			{
+				_epoch.wait(epoch);
+			}
+			--_sleeping;
+
+			if (job != nullptr)
+			{
+				Execute(job);
+			}
+			else if (_done)
+			{
+				break;
+			}
+		}
+	}
+}
@@ -1,10 +1,19 @@
 #pragma once
-#include <deque>
-#include <functional>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
 #include <string>
+#include <thread>
+#include <vector>
+#include "DMBlockPool.h"
+#include "DMInlineFunction.h"
 #include "DMSyncCounter.h"
+#include "DMTaskSystemConfig.h"
+#include "DMWorkStealingDeque.h"
+#include "concurrentqueue.h"
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
@@ -14,164 +23,192 @@
 #undef min
 #undef near
 #undef far
+#endif
 
 namespace dm::core::task
 {
-	class NotificationQueue
+	// workers always drain higher lanes first, Background is only starvation bounded
+	enum class Priority : uint8_t
+	{
+		Critical,
+		Normal,
+		Background,
+		Count
+	};
+
+	struct Job
+	{
+		// jobs are recycled through a pool, submitting one doesn't allocate once the pool is warm
+		static void* operator new(size_t size) { return BlockPool<sizeof(Job)>::Allocate(); }
+		static void operator delete(void* p) { BlockPool<sizeof(Job)>::Free(p); }
+
+		// captures up to 64 bytes are stored inline
+		InlineFunction<64> func;
+		// the job won't run until this reaches zero
+		std::shared_ptr<SyncCounter> dependency;
+		// incremented on submit and decremented once the job has run
+		std::shared_ptr<SyncCounter> signal;
+		// intrusive link for SyncCounter wait lists
+		Job* next = nullptr;
+		Priority priority = Priority::Normal;
+	};
+
+	struct TaskSystemStats
+	{
+		uint64_t executed;
+		uint64_t stolen;
+		uint64_t injected;
+		uint64_t parked;
+		uint64_t helped;
+		// time spent running jobs across all threads, compare with IOExecutorStats::ioNanoseconds
+		uint64_t busyNanoseconds;
+		uint64_t poolHeapAllocations;
+	};
+
+	class TaskSystem
 	{
 	public:
-		bool TryPop(std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>& func)
-		{
-			std::unique_lock<std::mutex> lock{ _mutex, std::try_to_lock };
-			if (!lock || _q.empty()) return false;
-			func = std::move(_q.front());
-			_q.pop_front();
-			return true;
-		}
+		explicit TaskSystem(const TaskSystemConfig& config = {});
+		~TaskSystem();
 
+		// no dependency fast path, skips the counter entirely
 		template <typename F>
-		bool TryPush(F&& f, const std::shared_ptr<SyncCounter>& fence)
+		void async_(F&& f, Priority priority = Priority::Normal)
 		{
-			{
-				std::unique_lock<std::mutex> lock{ _mutex, std::try_to_lock };
-				if (!lock) return false;
-				_q.emplace_back(std::pair(fence, std::forward<F>(f)));
-			}
-
-			_ready.notify_one();
-			return true;
+			Submit(new Job{ .func = std::forward<F>(f), .priority = priority });
 		}
 
-		bool Pop(std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>& func)
+		template <typename F>
+		void async_(F&& f, std::shared_ptr<SyncCounter> dep, Priority priority = Priority::Normal)
 		{
-			std::unique_lock<std::mutex> lock{ _mutex };
-			while (_q.empty() && !_done) _ready.wait(lock);
-			if (_q.empty()) return false;
-			func = std::move(_q.front());
-			_q.pop_front();
-			return true;
+			Submit(new Job{ .func = std::forward<F>(f), .dependency = std::move(dep), .priority = priority });
 		}
 
 		template <typename F>
-		void Push(F&& f, const std::shared_ptr<SyncCounter>& fence)
+		void async_(F&& f, std::shared_ptr<SyncCounter> dep, std::shared_ptr<SyncCounter> signal, Priority priority = Priority::Normal)
 		{
-			{
-				std::unique_lock<std::mutex> lock{ _mutex };
-				_q.emplace_back(std::pair(fence, std::forward<F>(f)));
-			}
-			_ready.notify_one();
+			signal->Increment();
+			Submit(new Job{ .func = std::forward<F>(f), .dependency = std::move(dep), .signal = std::move(signal), .priority = priority });
 		}
 
-		void Done()
+		// runs f once dep reaches zero, the returned counter reaches zero once f has run so continuations can be chained
+		template <typename F>
+		std::shared_ptr<SyncCounter> then(std::shared_ptr<SyncCounter> dep, F&& f, Priority priority = Priority::Normal)
 		{
-			{
-				std::unique_lock<std::mutex> lock{ _mutex };
-				_done = true;
-			}
-			_ready.notify_all();
+			auto done = MakeSyncCounter();
+			async_(std::forward<F>(f), std::move(dep), done, priority);
+			return done;
 		}
 
-	private:
-		std::deque<std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>> _q;
-		bool _done{ false };
-		std::mutex _mutex;
-		std::condition_variable _ready;
-	};
-
-	class TaskSystem
-	{
-	private:
-		
-	public:
-		TaskSystem()
+		// Queues every callable in tasks (moved from) with a single enqueue per queue and a single wakeup. counter, if any, is
+		// raised by the batch size up front and reaches zero once the whole batch has run.
+		template <typename F>
+		void SubmitBatch(std::span<F> tasks, std::shared_ptr<SyncCounter> counter = nullptr, Priority priority = Priority::Normal)
 		{
-			for (uint32_t i = 0; i != _count; i++)
-			{
-				_threads.emplace_back([&, i] { Run(i); });
-			}
+			SubmitBatch(tasks.size(), [tasks](size_t i) { return std::move(tasks[i]); }, std::move(counter), priority);
 		}
 
-		~TaskSystem()
+		// same, with the count jobs built by make(index), for batches that don't exist as an array already
+		template <typename Make> requires std::is_invocable_v<Make&, size_t>
+		void SubmitBatch(size_t count, Make&& make, std::shared_ptr<SyncCounter> counter = nullptr, Priority priority = Priority::Normal)
 		{
-			for (auto& q : _q)
-			{
-				q.Done();
-			}
+			if (count == 0)
+				return;
 
-			for (auto& t : _threads)
+			if (counter != nullptr)
 			{
-				t.join();
+				counter->Increment(static_cast<uint32_t>(count));
 			}
-		}
 
-		template <typename F>
-		void async_(F&& f, std::shared_ptr<SyncCounter> dep)
-		{
-			auto i = _index++;
-
-			for (uint32_t n = 0; n != _count * _k; ++n)
+			std::array<Job*, _batchChunk> jobs;
+			for (size_t first = 0; first < count; first += _batchChunk)
 			{
-				if (_q[(i + n) % _count].TryPush(std::forward<F>(f), dep)) return;
+				const auto chunk = std::min(_batchChunk, count - first);
+				for (size_t i = 0; i < chunk; i++)
+				{
+					jobs[i] = new Job{ .func = make(first + i), .signal = counter, .priority = priority };
+				}
+
+				PushBatch(std::span(jobs.data(), chunk), priority);
 			}
 
-			_q[i % _count].Push(std::forward<F>(f), dep);
+			Wake(static_cast<uint32_t>(std::min<size_t>(count, _count)));
 		}
 
-	private:
-		// 2 reserved threads, Main Thread + Render Thread. Everything else can be worker threads.
-		const uint32_t _count{ std::max(std::thread::hardware_concurrency() - 2, 1u)};
-		//const uint32_t _count = 1;
+		// queues a list of jobs released from a SyncCounter wait list
+		void Resume(Job* jobs);
 
-		std::vector<std::thread> _threads;
-		std::vector<NotificationQueue> _q{ _count };
-		std::atomic<uint32_t> _index{ 0 };
-		/*std::atomic<uint64_t> _fence_counter{ 0 };
-		std::atomic<uint64_t> _fence{ 0 };*/
-		static constexpr uint32_t _k = 5;
+		// Runs queued jobs on the calling thread until counter reaches zero, and only sleeps once there's nothing left to pick up.
+		// Threads outside the pool don't take background jobs here, a texture load shouldn't end up on the frame's critical path.
+		void WaitFor(SyncCounter& counter);
+		void WaitFor(const std::shared_ptr<SyncCounter>& counter) { WaitFor(*counter); }
+		// wakes threads sleeping in WaitFor to check their counter again, SyncCounter calls it when one reaches zero
+		void WakeHelpers();
 
-		void PushAny(const std::function<void()>& f, const std::shared_ptr<SyncCounter>& fenceVal)
-		{
-			const auto i = _index++;
-
-			for (uint32_t n = 0; n != _count * _k; ++n)
-			{
-				if (_q[(i + n) % _count].TryPush(f, fenceVal)) return;
-			}
+		uint32_t GetWorkerCount() const { return _count; }
+		uint32_t GetNodeCount() const { return static_cast<uint32_t>(_nodes.size()); }
+		TaskSystemStats GetStats() const;
+		// jobs queued in a lane and not yet picked up, parked jobs aren't counted
+		int64_t GetQueueDepth(Priority priority) const { return _depth[static_cast<size_t>(priority)].load(); }
 
-			_q[i % _count].Push(f, fenceVal);
-		}
+	private:
+		static constexpr size_t _laneCount = static_cast<size_t>(Priority::Count);
+		// a worker takes a background job after this many higher priority jobs in a row, if one is waiting
+		static constexpr uint32_t _backgroundStarvationLimit = 32;
+		// jobs per bulk enqueue in SubmitBatch, bounds the stack array
+		static constexpr size_t _batchChunk = 64;
 
-		void Run(const uint32_t i)
+		struct Worker
 		{
-			auto threadName = "Worker Thread " + std::to_string(i);
-			HRESULT hr = SetThreadDescription(GetCurrentThread(), utility::ToWideString(threadName).c_str());
-			//tracy::SetThreadName(threadName.c_str());
-			while (true)
-			{
-				bool gotFunc = false;
-				std::pair<std::shared_ptr<SyncCounter>, std::function<void()>> f;
-
-				for (uint32_t n = 0; n != _count; ++n)
-				{
-					if (_q[(i + n) % _count].TryPop(f))
-					{
-						gotFunc = true;
-						break;
-					}
-				}
+			std::array<WorkStealingDeque<Job*>, _laneCount> deques;
+			uint32_t sinceBackground = 0;
+			uint32_t node = 0;
+			// logical processors the thread pins itself to, empty when not pinned
+			std::vector<uint32_t> affinity;
+		};
+
+		// external threads (main, render, editor) can't touch the worker deques, they submit through here
+		struct NodeQueues
+		{
+			std::array<moodycamel::ConcurrentQueue<Job*>, _laneCount> lanes;
+		};
 
-				if (!gotFunc && !_q[i].Pop(f)) break;
+		uint32_t _count = 0;
 
-				if (!f.first->IsZero())
-				{
-					PushAny(f.second, f.first);
-				}
-				else
-				{
-					f.second();
-				}
-			}
-		}
+		std::vector<std::thread> _threads;
+		std::vector<std::unique_ptr<Worker>> _workers;
+		// a single entry unless the config asks for per node queues
+		std::vector<std::unique_ptr<NodeQueues>> _nodes;
+		// logical processor index to queue node, for routing submits from external threads
+		std::vector<uint32_t> _cpuNode;
+		std::array<std::atomic<int64_t>, _laneCount> _depth{};
+
+		// bumped on every submit, idle workers wait on it changing
+		std::atomic<uint32_t> _epoch{ 0 };
+		std::atomic<uint32_t> _sleeping{ 0 };
+		// threads waiting in WaitFor sleep on their own epoch, bumped on new work and on counters reaching zero
+		std::atomic<uint32_t> _helpEpoch{ 0 };
+		std::atomic<uint32_t> _helping{ 0 };
+		std::atomic<bool> _done{ false };
+
+		std::atomic<uint64_t> _executed{ 0 };
+		std::atomic<uint64_t> _stolen{ 0 };
+		std::atomic<uint64_t> _injected{ 0 };
+		std::atomic<uint64_t> _parked{ 0 };
+		std::atomic<uint64_t> _helped{ 0 };
+		std::atomic<uint64_t> _busyNanoseconds{ 0 };
+
+		void Configure(const TaskSystemConfig& config);
+		uint32_t CurrentNode() const;
+		void Submit(Job* job);
+		void Push(Job* job);
+		void PushBatch(std::span<Job*> jobs, Priority priority);
+		void Wake(uint32_t count = 1);
+		Job* FindJob(uint32_t i);
+		Job* FindJobInLane(uint32_t i, size_t lane);
+		Job* FindJobExternal();
+		void Execute(Job* job);
+		void Run(uint32_t i);
 	};
 
 	extern TaskSystem* GTaskSystem;
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+namespace dm::core::task
+{
+	enum class PinningPolicy : uint8_t
+	{
+		// leave placement to the OS scheduler
+		None,
+		// one logical processor per worker, spread across physical cores before doubling up on SMT siblings
+		Core,
+		// each worker may run anywhere on the NUMA node of the processor it would get with Core
+		Node
+	};
+
+	struct TaskSystemConfig
+	{
+		// 0 means one worker per logical processor the process may run on, minus reservedCores
+		uint32_t workerCount = 0;
+		// logical processors left for the engine and UI threads, only used when workerCount is 0
+		uint32_t reservedCores = 1;
+		PinningPolicy pinning = PinningPolicy::None;
+		// one set of injection queues per NUMA node, external threads submit to the node they're running on and workers
+		// check their own node first. Needs a pinning policy, without one workers have no home node
+		bool perNodeQueues = false;
+	};
+}
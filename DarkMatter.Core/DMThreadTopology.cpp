@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "DMThreadTopology.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "DMUtilities.h"
+#else
+#include <fstream>
+#include <filesystem>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dm::core::task
+{
+#ifdef _WIN32
+	std::vector<LogicalCpu> QueryCpuTopology()
+	{
+		// the legacy query only covers the current processor group, which is all a plain std::thread can run on anyway
+		DWORD length = 0;
+		GetLogicalProcessorInformation(nullptr, &length);
+		std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+		if (infos.empty() || !GetLogicalProcessorInformation(infos.data(), &length))
+			return {};
+
+		DWORD_PTR processMask, systemMask;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		{
+			processMask = ~DWORD_PTR{ 0 };
+		}
+
+		std::vector<LogicalCpu> cpus;
+		uint32_t core = 0;
+		for (const auto& info : infos)
+		{
+			if (info.Relationship != RelationProcessorCore)
+				continue;
+
+			for (uint32_t bit = 0; bit < sizeof(ULONG_PTR) * 8; bit++)
+			{
+				const auto mask = ULONG_PTR{ 1 } << bit;
+				if ((info.ProcessorMask & mask) == 0 || (processMask & mask) == 0)
+					continue;
+
+				UCHAR node = 0;
+				GetNumaProcessorNode(static_cast<UCHAR>(bit), &node);
+				cpus.push_back(LogicalCpu{ .index = bit, .core = core, .node = node == 0xFF ? 0u : node });
+			}
+
+			core++;
+		}
+
+		return cpus;
+	}
+
+	uint32_t GetCurrentCpu()
+	{
+		return GetCurrentProcessorNumber();
+	}
+
+	void SetCurrentThreadName(const std::string& name)
+	{
+		SetThreadDescription(GetCurrentThread(), utility::ToWideString(name).c_str());
+	}
+
+	bool PinCurrentThread(const std::vector<uint32_t>& cpus)
+	{
+		DWORD_PTR mask = 0;
+		for (const auto cpu : cpus)
+		{
+			mask |= DWORD_PTR{ 1 } << cpu;
+		}
+
+		return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+	}
+#else
+	namespace
+	{
+		uint32_t ReadSysValue(const std::filesystem::path& path, uint32_t fallback)
+		{
+			std::ifstream file(path);
+			uint32_t value;
+			return file >> value ? value : fallback;
+		}
+
+		uint32_t NodeOfCpu(uint32_t cpu)
+		{
+			// the cpu directory has a nodeN link on NUMA kernels, nothing at all otherwise
+			std::error_code ec;
+			for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec))
+			{
+				const auto name = entry.path().filename().string();
+				if (name.size() > 4 && name.starts_with("node"))
+					return static_cast<uint32_t>(std::stoul(name.substr(4)));
+			}
+
+			return 0;
+		}
+	}
+
+	std::vector<LogicalCpu> QueryCpuTopology()
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+			return {};
+
+		std::vector<LogicalCpu> cpus;
+		for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (!CPU_ISSET(cpu, &allowed))
+				continue;
+
+			const std::filesystem::path topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology";
+			// core ids are only unique within a package, fold the package in so two sockets don't share ids
+			const auto package = ReadSysValue(topology / "physical_package_id", 0);
+			const auto core = ReadSysValue(topology / "core_id", cpu);
+			cpus.push_back(LogicalCpu{ .index = cpu, .core = (package << 16) | core, .node = NodeOfCpu(cpu) });
+		}
+
+		std::ranges::sort(cpus, [](const LogicalCpu& a, const LogicalCpu& b) { return a.core != b.core ? a.core < b.core : a.index < b.index; });
+		return cpus;
+	}
+
+	uint32_t GetCurrentCpu()
+	{
+		const auto cpu = sched_getcpu();
+		return cpu < 0 ? 0 : static_cast<uint32_t>(cpu);
+	}
+
+	void SetCurrentThreadName(const std::string& name)
+	{
+		// linux caps thread names at 15 characters plus the terminator
+		pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+	}
+
+	bool PinCurrentThread(const std::vector<uint32_t>& cpus)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (const auto cpu : cpus)
+		{
+			CPU_SET(cpu, &set);
+		}
+
+		return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+#endif
+}
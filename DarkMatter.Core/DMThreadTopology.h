@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dm::core::task
+{
+	struct LogicalCpu
+	{
+		// OS index of the logical processor, what affinity calls take
+		uint32_t index;
+		// physical core id, SMT siblings share it
+		uint32_t core;
+		uint32_t node;
+	};
+
+	// Logical processors this process is allowed to run on, ordered by core then index so the SMT siblings of a core are
+	// next to each other. Respects the process affinity mask, so a taskset/cgroup limited process only sees its own CPUs.
+	std::vector<LogicalCpu> QueryCpuTopology();
+
+	// logical processor the calling thread is running on right now, cheap enough to call per submit
+	uint32_t GetCurrentCpu();
+
+	void SetCurrentThreadName(const std::string& name);
+
+	// restricts the calling thread to the given logical processors, returns false if the OS refused
+	bool PinCurrentThread(const std::vector<uint32_t>& cpus);
+}
@@ -1,35 +1,72 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 namespace dm::core
 {
+	// Lets one thread stop another at a known point. The requester calls Lock/Unlock, the other thread calls AcknowledgeLock
+	// wherever it's safe to be stopped. Both sides spin briefly, then sleep on the state, so a long lock doesn't burn two cores.
 	class TwoThreadSync
 	{
 	public:
 		void Lock()
 		{
-			_lockRequested = true;
-			while (!_locked){}
+			_state = Requested;
+			WaitWhile(Requested);
 		}
 
 		void Unlock()
 		{
-			_lockRequested = false;
-			while (_locked){}
+			_state = Released;
+			_state.notify_one();
+			WaitWhile(Released);
 		}
 
 		void AcknowledgeLock()
 		{
-			if (_lockRequested)
+			if (_state.load() != Requested)
+				return;
+
+			_state = Locked;
+			_state.notify_one();
+			WaitWhile(Locked);
+
+			_state = Idle;
+			_state.notify_one();
+		}
+
+	private:
+		enum State : uint32_t
+		{
+			Idle,
+			Requested,
+			Locked,
+			Released
+		};
+
+		// long enough to cover a handoff where the other side is already waiting, short enough not to matter otherwise
+		static constexpr uint32_t _spinCount = 4096;
+
+		void WaitWhile(State state) const
+		{
+			for (uint32_t i = 0; i < _spinCount && _state.load() == state; i++)
 			{
-				_locked = true;
-				while (_lockRequested){}
-				_locked = false;
+#if defined(_M_X64) || defined(__x86_64__)
+				_mm_pause();
+#endif
+			}
+
+			while (_state.load() == state)
+			{
+				_state.wait(state);
 			}
 		}
-	private:
-		std::atomic<bool> _lockRequested = false;
-		std::atomic<bool> _locked = false;
+
+		std::atomic<uint32_t> _state = Idle;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace dm::core::task
+{
+	// Chase-Lev work stealing deque, using the memory orderings from "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013).
+	// Push and Pop may only be called by the owning worker, Steal may be called from any thread.
+	template <typename T>
+	class WorkStealingDeque
+	{
+		static_assert(std::is_pointer_v<T>, "WorkStealingDeque only stores pointers");
+
+	public:
+		explicit WorkStealingDeque(int64_t capacity = 1024)
+		{
+			_ring.store(new Ring(capacity), std::memory_order_relaxed);
+		}
+
+		WorkStealingDeque(const WorkStealingDeque& other) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque& other) = delete;
+
+		~WorkStealingDeque()
+		{
+			for (auto ring : _retired)
+			{
+				delete ring;
+			}
+
+			delete _ring.load(std::memory_order_relaxed);
+		}
+
+		void Push(T item)
+		{
+			const auto bottom = _bottom.load(std::memory_order_relaxed);
+			const auto top = _top.load(std::memory_order_acquire);
+			auto ring = _ring.load(std::memory_order_relaxed);
+
+			if (bottom - top > ring->capacity - 1)
+			{
+				ring = Grow(ring, top, bottom);
+			}
+
+			ring->Put(bottom, item);
+			std::atomic_thread_fence(std::memory_order_release);
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		T Pop()
+		{
+			const auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+			auto ring = _ring.load(std::memory_order_relaxed);
+			_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto top = _top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				// empty, restore bottom
+				_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T item = ring->Get(bottom);
+
+			if (top == bottom)
+			{
+				// last item, race against stealers for it
+				if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					item = nullptr;
+				}
+
+				_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+
+			return item;
+		}
+
+		// returns nullptr if the deque is empty or another thread won the race for the top item
+		T Steal()
+		{
+			auto top = _top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const auto bottom = _bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			auto ring = _ring.load(std::memory_order_acquire);
+			T item = ring->Get(top);
+
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+
+			return item;
+		}
+
+		[[nodiscard]] size_t SizeApprox() const
+		{
+			const auto bottom = _bottom.load(std::memory_order_relaxed);
+			const auto top = _top.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+		}
+
+	private:
+		struct Ring
+		{
+			explicit Ring(int64_t cap) : capacity(cap), mask(cap - 1), items(new std::atomic<T>[cap]) {}
+			~Ring() { delete[] items; }
+
+			void Put(int64_t i, T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+			T Get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+
+			int64_t capacity;
+			int64_t mask;
+			std::atomic<T>* items;
+		};
+
+		Ring* Grow(Ring* old, int64_t top, int64_t bottom)
+		{
+			auto ring = new Ring(old->capacity * 2);
+			for (auto i = top; i != bottom; ++i)
+			{
+				ring->Put(i, old->Get(i));
+			}
+
+			// stealers may still be reading from the old ring, keep it alive until the deque dies
+			_retired.push_back(old);
+			_ring.store(ring, std::memory_order_release);
+			return ring;
+		}
+
+		alignas(64) std::atomic<int64_t> _top{ 0 };
+		alignas(64) std::atomic<int64_t> _bottom{ 0 };
+		alignas(64) std::atomic<Ring*> _ring{ nullptr };
+		std::vector<Ring*> _retired;
+	};
+}
@@ -3,9 +3,11 @@
 #include "DMEditorCamera.h"
 #include "DMInputSystem.h"
 #include "DMRealFileSystem.h"
+#include "DMTerrainFile.h"
 #include "imgui_impl_sdl3.h"
 #include "imgui_internal.h"
 
+#include <chrono>
 #include <format>
 
 #include "DMEditorDialogImportTexture.h"
@@ -202,24 +204,17 @@ namespace dm::editor
 
 		_engine->SetWorldModel(std::move(world));
 
-		// TODO TEMP
+		// TODO TEMP, a saved world brings its own terrain
+		if (!_engine->GetFileSystem()->FileExists("meta/terrain.dmt"))
 		{
-			auto heightmapSize = _engine->GetFileSystem()->FileSize("test/Hydro.r32");
-			auto numFloats = heightmapSize / sizeof(float);
-			auto heightmapRaw = std::vector<float>(numFloats);
-			_engine->GetFileSystem()->ReadFile("test/Hydro.r32", reinterpret_cast<char*>(heightmapRaw.data()));
-
 			auto w = _engine->GetWorld();
 
-			auto& terrainFloats = w->terrainHeightMap.GetFloatData();
-
-			for (int x = 0; x < 1024; x++)
-			{
-				for (int y = 0; y < 1024; y++)
-				{
-					terrainFloats[x][y] = heightmapRaw[x + (y * 1024)] * 5000.f;
-				}
-			}
+			// the raw file is column major, the importer turns it into rows on the way in
+			const auto importStart = std::chrono::steady_clock::now();
+			w->terrainHeightMap.ImportRawHeights(_engine->GetFileSystem(), "test/Hydro.r32",
+				{ .format = model::RawHeightFormat::R32Float, .columnMajor = true, .scale = 5000.f });
+			const std::chrono::duration<double, std::milli> importTime = std::chrono::steady_clock::now() - importStart;
+			_log.information(std::format("Imported test/Hydro.r32 in {:.2f} ms", importTime.count()));
 		}
 
 		_log.information("Created world");
@@ -233,6 +228,17 @@ namespace dm::editor
 			auto serializedAssetRegistry = GetAssetRegistry()->SerializeRegistry();
 			fileSystem->WriteFile("meta/assets.json", serializedAssetRegistry.data(), serializedAssetRegistry.size(), false);
 		}
+		if (const auto* pPaged = GetWorld()->pagedHeightMap.get(); pPaged != nullptr)
+		{
+			// paged heights are read only, the file they're paged from already is the terrain
+			_log.information(std::format("Terrain is paged from {}, left it as it is", pPaged->GetPath()));
+		}
+		else
+		{
+			// terrain
+			const auto stats = model::SaveTerrainFile(fileSystem, "meta/terrain.dmt", GetWorld()->terrainHeightMap);
+			_log.information(std::format("Saved terrain, {:.1f} MB to {:.1f} MB in {:.1f} ms", stats.rawBytes / 1e6, stats.fileBytes / 1e6, stats.milliseconds));
+		}
 	}
 
 }
@@ -1,4 +1,5 @@
 #include "pch.h"
+#include <chrono>
 #include <format>
 #include "imgui.h"
 #include "DMEditor.h"
@@ -19,6 +20,33 @@ namespace dm::editor
 		{
 			_mode = TerrainEditorMode::Raise;
 		}
+
+		auto& heightMap = _editor->GetWorld()->terrainHeightMap;
+		bool quantized = heightMap.GetHeightStorage() == model::HeightStorage::UNorm16;
+		if (!heightMap.HasHeights())
+		{
+			// paged heights stay in whatever storage the file has
+			ImGui::Text("Heights are paged, storage can't change");
+		}
+		else if (ImGui::Checkbox("16 bit heights", &quantized))
+		{
+			_quantizationError = heightMap.SetHeightStorage(quantized ? model::HeightStorage::UNorm16 : model::HeightStorage::Float32);
+		}
+		if (quantized)
+		{
+			ImGui::Text(std::format("Height range: {} + [0, {}], max conversion error: {}", heightMap.GetHeightOffset(), heightMap.GetHeightScale(), _quantizationError).c_str());
+		}
+		ImGui::End();
+
+		ImGui::Begin("Ray cast terrain stats");
+		if (ImGui::Button("Benchmark SampleHeights"))
+		{
+			BenchmarkSampleHeights();
+		}
+		if (_samplesPerSecond > 0.0)
+		{
+			ImGui::Text(std::format("SampleHeights: {:.1f} M samples/s", _samplesPerSecond / 1e6).c_str());
+		}
 		ImGui::End();
 
 		auto activeCamera = std::dynamic_pointer_cast<core::Camera>(
@@ -45,8 +73,13 @@ namespace dm::editor
 	void TerrainEditor::HandleRaiseLowerTool()
 	{
 		auto& heightMap = _editor->GetWorld()->terrainHeightMap;
-		heightMap.ClearOverlay({0, 0, 0, 0});
-		heightMap.overlayDirty = true;
+
+		// only wipe what the last frame painted, so the overlay upload stays a few tiles
+		if (_brushRegion.has_value())
+		{
+			heightMap.FillOverlay(_brushRegion->x, _brushRegion->z, _brushRegion->width, _brushRegion->height, { 0, 0, 0, 0 });
+			_brushRegion.reset();
+		}
 
 		auto heightMapPointOpt = GetHeightMapPoint(
 			std::dynamic_pointer_cast<core::Camera>(
@@ -59,30 +92,64 @@ namespace dm::editor
 
 		auto heightMapPoint = heightMapPointOpt.value();
 		auto heightMapWidth = heightMap.GetWidth();
-		auto& overlayData = heightMap.GetOverlayData();
+		auto& overlay = heightMap.GetOverlay();
 		int radius = 20;
 
 		auto affectedPoints = GetAffectedIndices(heightMapPoint, radius, static_cast<int32_t>(heightMapWidth));
 
 		for (const auto& affectedPoint : affectedPoints)
 		{
-			overlayData[affectedPoint.y][affectedPoint.x] = { 255, 0, 0, 1 };
+			overlay.Set(affectedPoint.x, affectedPoint.y, { 255, 0, 0, 1 });
 		}
+
+		const auto x0 = std::max(heightMapPoint.x - radius, 0);
+		const auto z0 = std::max(heightMapPoint.y - radius, 0);
+		const auto x1 = std::min(heightMapPoint.x + radius + 1, static_cast<int32_t>(heightMapWidth));
+		const auto z1 = std::min(heightMapPoint.y + radius + 1, static_cast<int32_t>(heightMapWidth));
+		_brushRegion = BrushRegion{ .x = static_cast<size_t>(x0), .z = static_cast<size_t>(z0), .width = static_cast<size_t>(x1 - x0), .height = static_cast<size_t>(z1 - z0) };
 	}
 
 
+	void TerrainEditor::BenchmarkSampleHeights()
+	{
+		const auto& heightMap = _editor->GetWorld()->terrainHeightMap;
+		const auto* pPaged = _editor->GetWorld()->pagedHeightMap.get();
+		const float worldExtent = heightMap.GetWorldExtent();
+
+		// spread over the whole map so the batch sees cache misses like a long ray or a scatter would
+		constexpr size_t sampleCount = 1 << 20;
+		std::vector<glm::vec2> positions(sampleCount);
+		for (size_t i = 0; i < sampleCount; i++)
+		{
+			// R2 low discrepancy sequence, in double so the fraction survives large i
+			positions[i] = { static_cast<float>(std::fmod(i * 0.7548776662466927, 1.0)) * worldExtent,
+				static_cast<float>(std::fmod(i * 0.5698402909980532, 1.0)) * worldExtent };
+		}
+		std::vector<float> heights(sampleCount);
+
+		const auto start = std::chrono::steady_clock::now();
+		if (pPaged != nullptr)
+			pPaged->SampleHeights(positions, heights);
+		else
+			heightMap.SampleHeights(positions, heights);
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		_samplesPerSecond = seconds > 0.0 ? sampleCount / seconds : 0.0;
+		_log.information(std::format("SampleHeights: {} samples in {:.2f} ms, {:.1f} M samples/s", sampleCount, seconds * 1e3, _samplesPerSecond / 1e6));
+	}
+
 	void TerrainEditor::SetSelectedCell(model::Cell* pCell)
 	{
 		_selectedCell = pCell;
 	}
 
-	std::optional<glm::ivec2> TerrainEditor::GetHeightMapPoint(core::Camera* camera) const
+	std::optional<glm::ivec2> TerrainEditor::GetHeightMapPoint(core::Camera* camera)
 	{
-		auto heightMap = _editor->GetWorld()->terrainHeightMap;
+		const auto& heightMap = _editor->GetWorld()->terrainHeightMap;
 		auto mousePos = core::InputSystem::inputState.mousePosLocal;
 		auto screenSize = _editor->GetScreenSize();
 
-		HeightMapRay ray;
+		model::TerrainRay ray;
 		{
 			auto mouseNdcX = 2.f * mousePos.x / screenSize.width - 1.f;
 			auto mouseNdcY = 1.f - 2.f * mousePos.y / screenSize.height;
@@ -97,61 +164,39 @@ namespace dm::editor
 			ray.direction = glm::normalize(glm::vec3(worldRay));
 		}
 
-
-		float t = 0.0f;
-		constexpr float stepSize = 2.5f;
-		constexpr float tMax = 5120.f;
-		bool hit = false;
-
-		uint64_t rayMarchIterations = 0;
-
-		while (t < tMax)
+		// the world can be swapped out under the editor, the query has to follow its height map. paged heights are
+		// only picked where they're resident
+		if (const auto* pPaged = _editor->GetWorld()->pagedHeightMap.get(); pPaged != nullptr)
 		{
-			rayMarchIterations++;
-			glm::vec3 pos = ray.origin + ray.direction * t;
-			float terrainHeight = heightMap.GetHeight(pos.x, pos.z);
-
-			if (pos.y < terrainHeight)
-			{
-				hit = true;
-				break;
-			}
-			t += stepSize;
+			if (_rayQuery == nullptr || _rayQuery->GetPagedHeightMap() != pPaged)
+				_rayQuery = std::make_unique<model::TerrainRayQuery>(*pPaged);
 		}
-
-		if (!hit)
-			return std::optional<glm::ivec2>();
-
-		float tLow = t - stepSize;
-		float tHigh = t;
-		constexpr int maxIterations = 10;
-
-		for (int i = 0; i < maxIterations; ++i)
+		else if (_rayQuery == nullptr || _rayQuery->GetHeightMap() != &heightMap)
 		{
-			float tMid = (tLow + tHigh) * 0.5f;
-			glm::vec3 posMid = ray.origin + ray.direction * tMid;
-			float terrainHeight = heightMap.GetHeight(posMid.x, posMid.z);
-
-			if (posMid.y < terrainHeight)
-				tHigh = tMid;
-			else
-				tLow = tMid;
+			_rayQuery = std::make_unique<model::TerrainRayQuery>(heightMap);
 		}
 
-		glm::vec3 hitWorldPos = ray.origin + ray.direction * tHigh;
+		const auto hit = _rayQuery->Intersect(ray);
+
+		if (!hit.hit)
+			return std::optional<glm::ivec2>();
+
+		const float worldExtent = heightMap.GetWorldExtent();
+		glm::vec3 hitWorldPos = hit.position;
 
-		float u = hitWorldPos.x / 5120.0f;
-		float v = hitWorldPos.z / 5120.0f;
+		float u = hitWorldPos.x / worldExtent;
+		float v = hitWorldPos.z / worldExtent;
 
-		int texX = static_cast<int>(std::round(u * (1024 - 1)));
-		int texZ = static_cast<int>(std::round(v * (1024 - 1)));
+		const auto lastTexel = static_cast<float>(heightMap.GetWidth() - 1);
+		int texX = static_cast<int>(std::round(u * lastTexel));
+		int texZ = static_cast<int>(std::round(v * lastTexel));
 
 		auto outHitTexCoord = glm::ivec2(texX, texZ);
 
 		ImGui::Begin("Ray cast terrain stats");
-		ImGui::Text(std::format("Iterations: {}", rayMarchIterations).c_str());
+		ImGui::Text(std::format("Iterations: {}", hit.iterations).c_str());
 		ImGui::Text(std::format("X: {}, Y: {}", outHitTexCoord.x, outHitTexCoord.y).c_str());
-		ImGui::Text(std::format("Raw: X: {}, Y: {}", u * 1023, v * 1023).c_str());
+		ImGui::Text(std::format("Raw: X: {}, Y: {}", u * lastTexel, v * lastTexel).c_str());
 		ImGui::End();
 
 		if (outHitTexCoord.x >= 0 && outHitTexCoord.x < heightMap.GetWidth() && outHitTexCoord.y >= 0 &&
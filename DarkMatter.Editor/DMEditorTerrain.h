@@ -2,6 +2,7 @@
 #include "DMCamera.h"
 #include "DMCell.h"
 #include "DMLogger.h"
+#include "DMTerrainRayQuery.h"
 
 namespace dm::editor
 {
@@ -24,10 +25,13 @@ namespace dm::editor
 			glm::vec3 positions[4];
 		};
 
-		struct HeightMapRay
+		// overlay texels painted by the brush last frame
+		struct BrushRegion
 		{
-			glm::vec3 origin;
-			glm::vec3 direction;
+			size_t x;
+			size_t z;
+			size_t width;
+			size_t height;
 		};
 
 		enum class TerrainEditorMode
@@ -36,11 +40,19 @@ namespace dm::editor
 			Raise
 		};
 
-		std::optional<glm::ivec2> GetHeightMapPoint(core::Camera* camera) const;
+		std::optional<glm::ivec2> GetHeightMapPoint(core::Camera* camera);
 		std::vector<glm::ivec2> GetAffectedIndices(glm::ivec2 point, int32_t radius, int32_t max);
 		void HandleRaiseLowerTool();
+		// times one batched SampleHeights call over the whole map, for the ray cast stats window
+		void BenchmarkSampleHeights();
 
 		model::Cell* _selectedCell = nullptr;
+		std::optional<BrushRegion> _brushRegion;
+		std::unique_ptr<model::TerrainRayQuery> _rayQuery;
+		// largest height change from the last storage switch
+		float _quantizationError = 0.f;
+		// from the last BenchmarkSampleHeights, zero until it has run
+		double _samplesPerSecond = 0.0;
 
 		Editor* _editor;
 		TerrainEditorMode _mode = TerrainEditorMode::None;
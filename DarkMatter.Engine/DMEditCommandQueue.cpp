@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "DMEditCommandQueue.h"
+
+#include <exception>
+#include <utility>
+
+namespace dm
+{
+	EditCommandQueue::~EditCommandQueue()
+	{
+		// whoever is still waiting gets a broken_promise instead of hanging
+		auto command = _head.exchange(nullptr);
+		while (command != nullptr)
+		{
+			delete std::exchange(command, command->next);
+		}
+	}
+
+	std::shared_future<void> EditCommandQueue::Enqueue(const void* target, std::function<void()> apply)
+	{
+		auto command = new Command{ .target = target, .apply = std::move(apply), .next = _head.load(std::memory_order_relaxed) };
+		auto future = command->done.get_future().share();
+
+		while (!_head.compare_exchange_weak(command->next, command, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+
+		return future;
+	}
+
+	size_t EditCommandQueue::Drain()
+	{
+		Command* newestFirst = _head.exchange(nullptr, std::memory_order_acquire);
+
+		Command* oldestFirst = nullptr;
+		while (newestFirst != nullptr)
+		{
+			auto next = newestFirst->next;
+			newestFirst->next = oldestFirst;
+			oldestFirst = newestFirst;
+			newestFirst = next;
+		}
+
+		size_t applied = 0;
+		while (oldestFirst != nullptr)
+		{
+			// find the end of the run of edits to the same target, only its last edit gets applied
+			auto last = oldestFirst;
+			while (last->target != nullptr && last->next != nullptr && last->next->target == last->target)
+			{
+				last = last->next;
+			}
+
+			std::exception_ptr exception;
+			try
+			{
+				last->apply();
+				++applied;
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+
+			const auto end = last->next;
+			while (oldestFirst != end)
+			{
+				auto command = std::exchange(oldestFirst, oldestFirst->next);
+
+				if (exception)
+				{
+					command->done.set_exception(exception);
+				}
+				else
+				{
+					command->done.set_value();
+				}
+
+				delete command;
+			}
+		}
+
+		return applied;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <future>
+
+namespace dm
+{
+	// Multi producer, single consumer queue of world edits. Any thread can queue an edit without blocking, the engine thread
+	// applies them all at the start of its next tick. Edits come out in the order they were queued.
+	class EditCommandQueue
+	{
+	public:
+		EditCommandQueue() = default;
+		~EditCommandQueue();
+
+		EditCommandQueue(const EditCommandQueue& other) = delete;
+
+		// A run of back to back edits with the same non-null target is coalesced, only the last one is applied. Only pass a
+		// target when apply overwrites all of that target's edited state. The future is ready once the edit (or the one that replaced it) has been applied.
+		std::shared_future<void> Enqueue(const void* target, std::function<void()> apply);
+
+		// applies everything queued so far on the calling thread, returns the number of edits applied
+		size_t Drain();
+
+	private:
+		struct Command
+		{
+			const void* target;
+			std::function<void()> apply;
+			std::promise<void> done;
+			Command* next;
+		};
+
+		// pushed newest first, Drain reverses it back into submission order
+		std::atomic<Command*> _head{ nullptr };
+	};
+}
@@ -2,7 +2,9 @@
 #include "DMEngine.h"
 
 #include "DMCamera.h"
+#include "DMGlobalSettings.h"
 #include "DMInputSystem.h"
+#include "DMIOExecutor.h"
 #include <format>
 #include "imgui.h"
 
@@ -13,7 +15,8 @@ namespace dm
 		_pWindow = pWindow;
 		_renderer = std::make_unique<renderer::Renderer>(_pWindow, width, height);
 		core::InputSystem::Init();
-		core::task::GTaskSystem = new core::task::TaskSystem;
+		core::task::GTaskSystem = new core::task::TaskSystem(core::GSettings.TaskSystem);
+		core::task::GIOExecutor = new core::task::IOExecutor(core::GSettings.IOThreadCount);
 	}
 
 	Engine::~Engine()  // NOLINT(modernize-use-equals-default) These have to be released in a certain order
@@ -21,6 +24,8 @@ namespace dm
 		_log.information("Shutting down...");
 		_world.reset();
 		_renderer.reset();
+		// I/O threads hand their results to the task system, so they go first
+		delete core::task::GIOExecutor;
 		delete core::task::GTaskSystem;
 		_log.information("Shutdown complete");
 	}
@@ -53,14 +58,23 @@ namespace dm
 
 	void Engine::Render()
 	{
-		if (_world != nullptr)
-			_renderer->RenderWorld();
+		// rendering only reads the published snapshot, never the live world
+		if (auto snapshot = _snapshots.Acquire(); _world != nullptr && snapshot != nullptr)
+			_renderer->RenderWorld(*snapshot);
 
 		_renderer->Present();
 	}
 
+	std::shared_future<void> Engine::QueueEdit(const void* target, std::function<void()> apply)
+	{
+		return _edits.Enqueue(target, std::move(apply));
+	}
+
 	void Engine::Tick()
 	{
+		// edits land between frames, nothing this tick sees the world half edited
+		_edits.Drain();
+
 		if (_world != nullptr)
 		{
 			for (auto& obj : _world->globalObjectStore)
@@ -72,6 +86,53 @@ namespace dm
 			ImGui::Begin("Camera stats");
 			ImGui::Text(std::format("X: {}, Y: {}, Z: {}", cam->position.x, cam->position.y, cam->position.z).c_str());
 			ImGui::End();
+
+			if (auto& paged = _world->pagedHeightMap; paged != nullptr)
+			{
+				paged->UpdateResidency({ cam->position.x, cam->position.z }, core::GSettings.TerrainPageRadius);
+
+				auto pageStats = paged->GetStats();
+				ImGui::Begin("Terrain paging stats");
+				ImGui::Text(std::format("Pages: {} x {}", paged->GetPagesPerRow(), paged->GetPagesPerRow()).c_str());
+				ImGui::Text(std::format("Resident: {} / {}", pageStats.residentPages, core::GSettings.TerrainResidentPages).c_str());
+				ImGui::Text(std::format("Resident memory: {:.1f} MB", pageStats.residentBytes / (1024.0 * 1024.0)).c_str());
+				ImGui::Text(std::format("Loading: {}", pageStats.loadingPages).c_str());
+				ImGui::Text(std::format("Loads: {}", pageStats.loads).c_str());
+				ImGui::Text(std::format("Evictions: {}", pageStats.evictions).c_str());
+				ImGui::Text(std::format("Failed loads: {}", pageStats.failedLoads).c_str());
+				const auto ground = _world->GetTerrainHeight(cam->position.x, cam->position.z);
+				ImGui::Text((ground.has_value() ? std::format("Ground under camera: {:.1f}", *ground) : std::string("Ground under camera: not resident")).c_str());
+				ImGui::End();
+			}
+
+			// unchanged cells and terrain tiles are shared with the previous version
+			_snapshots.Publish(model::BuildSnapshot(*_world, _snapshots.Acquire()));
+		}
+
+		{
+			auto taskStats = core::task::GTaskSystem->GetStats();
+			ImGui::Begin("Task system stats");
+			ImGui::Text(std::format("Workers: {}", core::task::GTaskSystem->GetWorkerCount()).c_str());
+			ImGui::Text(std::format("Queue nodes: {}", core::task::GTaskSystem->GetNodeCount()).c_str());
+			ImGui::Text(std::format("Executed: {}", taskStats.executed).c_str());
+			ImGui::Text(std::format("Stolen: {}", taskStats.stolen).c_str());
+			ImGui::Text(std::format("Injected: {}", taskStats.injected).c_str());
+			ImGui::Text(std::format("Parked: {}", taskStats.parked).c_str());
+			ImGui::Text(std::format("Helped: {}", taskStats.helped).c_str());
+			ImGui::Text(std::format("Pool heap allocations: {}", taskStats.poolHeapAllocations).c_str());
+			ImGui::Text(std::format("CPU time: {:.1f} ms", taskStats.busyNanoseconds / 1e6).c_str());
+			ImGui::Text(std::format("Queued critical: {}", core::task::GTaskSystem->GetQueueDepth(core::task::Priority::Critical)).c_str());
+			ImGui::Text(std::format("Queued normal: {}", core::task::GTaskSystem->GetQueueDepth(core::task::Priority::Normal)).c_str());
+			ImGui::Text(std::format("Queued background: {}", core::task::GTaskSystem->GetQueueDepth(core::task::Priority::Background)).c_str());
+			ImGui::End();
+
+			auto ioStats = core::task::GIOExecutor->GetStats();
+			ImGui::Begin("IO stats");
+			ImGui::Text(std::format("IO threads: {}", core::task::GIOExecutor->GetThreadCount()).c_str());
+			ImGui::Text(std::format("Requests: {}", ioStats.requests).c_str());
+			ImGui::Text(std::format("Bytes read: {}", ioStats.bytesRead).c_str());
+			ImGui::Text(std::format("IO wait time: {:.1f} ms", ioStats.ioNanoseconds / 1e6).c_str());
+			ImGui::End();
 		}
 
 		core::InputSystem::inputState.mouseDelta = {};
@@ -100,6 +161,12 @@ namespace dm
 
 		_renderer->SetWorld(_world.get(), _fileSystem.get());
 
+		// readers on other threads shouldn't see an empty world until the first tick
+		if (_world != nullptr)
+		{
+			_snapshots.Publish(model::BuildSnapshot(*_world, _snapshots.Acquire()));
+		}
+
 		return oldModel;
 	}
 
@@ -5,6 +5,7 @@
 #include "DMRenderer.h"
 #include <SDL3/SDL_video.h>
 
+#include "DMEditCommandQueue.h"
 #include "DMFileSystem.h"
 
 namespace dm
@@ -35,6 +36,10 @@ namespace dm
 		void LoadFromFolder(const std::string& path);
 		void SaveToFolder(const std::string& path) const;
 		void LoadAssetsRegistryFile(const std::string& path) const;
+		// safe from any thread, see EditCommandQueue::Enqueue. Applied at the start of the next Tick
+		std::shared_future<void> QueueEdit(const void* target, std::function<void()> apply);
+		// world as of the end of the last Tick, safe to read from any thread
+		std::shared_ptr<const model::WorldSnapshot> GetSnapshot() const { return _snapshots.Acquire(); }
 	private:
 		
 
@@ -45,5 +50,7 @@ namespace dm
 		std::unique_ptr<dm::model::WorldModel> _world;
 		std::unique_ptr<dm::renderer::Renderer> _renderer;
 		std::unique_ptr<dm::core::FileSystem> _fileSystem;
+		EditCommandQueue _edits;
+		model::WorldSnapshotChannel _snapshots;
 	};
 }
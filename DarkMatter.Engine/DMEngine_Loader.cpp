@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "DMEngine.h"
 
+#include <format>
+
+#include "DMGlobalSettings.h"
+#include "DMTerrainFile.h"
+
 namespace dm
 {
 	void Engine::LoadFromFolder(const std::string& path)
@@ -9,6 +14,34 @@ namespace dm
 		 {
 			 LoadAssetsRegistryFile(path + "/assets.json");
 		 }
+
+		 const auto terrainPath = path + "/terrain.dmt";
+		 _world->pagedHeightMap.reset();
+		 if (_fileSystem->FileExists(terrainPath))
+		 {
+			 // a map with more height tiles than the page budget is never loaded whole, its heights are paged out of the
+			 // file and read only. anything smaller loads whole and stays editable
+			 const auto budget = core::GSettings.TerrainResidentPages;
+			 const auto tilesPerRow = model::TerrainFileReader(_fileSystem.get(), terrainPath).GetTilesPerRow(model::TerrainFileLayer::Heights);
+			 model::TerrainFileStats stats;
+			 if (tilesPerRow * tilesPerRow > budget)
+			 {
+				 _world->pagedHeightMap = model::PagedHeightMap::Open(_fileSystem.get(), terrainPath, budget);
+				 _world->terrainHeightMap = model::LoadTerrainFileWithoutHeights(_fileSystem.get(), terrainPath, &stats);
+				 _log.information(std::format("Paging terrain.dmt heights, {} x {} pages, at most {} resident", tilesPerRow, tilesPerRow, budget));
+			 }
+			 else
+			 {
+				 _world->terrainHeightMap = model::LoadTerrainFile(_fileSystem.get(), terrainPath, &stats);
+			 }
+
+			 _log.information(std::format("Loaded terrain.dmt, {:.1f} MB from {:.1f} MB on disk in {:.1f} ms ({:.0f} MB/s)",
+				 stats.rawBytes / 1e6, stats.fileBytes / 1e6, stats.milliseconds, stats.milliseconds > 0.0 ? stats.rawBytes / 1e3 / stats.milliseconds : 0.0));
+
+			 const auto& splat = _world->terrainHeightMap.GetSplat();
+			 _log.information(std::format("Splat has {} of {} tiles painted",
+				 splat.GetMaterializedTiles(), splat.GetTilesPerRow() * splat.GetTilesPerRow()));
+		 }
 	}
 
 	void Engine::LoadAssetsRegistryFile(const std::string& path) const
@@ -23,6 +56,26 @@ namespace dm
 			auto assetJson = _world->assetRegistry.SerializeRegistry();
 			_fileSystem->WriteFile(path + "/assets.json", assetJson.data(), assetJson.size(), false);
 		}
+
+		if (const auto* pPaged = _world->pagedHeightMap.get(); pPaged != nullptr)
+		{
+			// paged heights are read only and only exist in the file they're paged from, so that file is the terrain as
+			// it is. saving somewhere else copies it straight out of the mapping
+			const auto terrainPath = path + "/terrain.dmt";
+			if (terrainPath != pPaged->GetPath())
+			{
+				const auto source = _fileSystem->MapFile(pPaged->GetPath());
+				_fileSystem->WriteFile(terrainPath, const_cast<char*>(source->GetData()), source->GetSize(), false);
+			}
+
+			_log.information(std::format("Kept terrain.dmt as paged from {}", pPaged->GetPath()));
+		}
+		else
+		{
+			const auto stats = model::SaveTerrainFile(_fileSystem.get(), path + "/terrain.dmt", _world->terrainHeightMap);
+			_log.information(std::format("Saved terrain.dmt, {:.1f} MB to {:.1f} MB ({:.2f}x) in {:.1f} ms",
+				stats.rawBytes / 1e6, stats.fileBytes / 1e6, stats.fileBytes > 0 ? static_cast<double>(stats.rawBytes) / stats.fileBytes : 0.0, stats.milliseconds));
+		}
 	}
 
 }
\ No newline at end of file
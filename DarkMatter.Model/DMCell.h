@@ -30,6 +30,7 @@ namespace dm::model
 		glm::vec3 GetCenter() const { return _center; }
 
 		std::string& GetName() { return _name; }
+		const std::string& GetName() const { return _name; }
 
 	private:
 		uint32_t _textures[4];
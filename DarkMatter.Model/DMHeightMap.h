@@ -1,30 +1,151 @@
 #pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <glm/vec2.hpp>
+
+#include "DMAlignedBuffer.h"
+#include "DMFileSystem.h"
 #include "DMGraphicsPrimitives.h"
+#include "DMGridView.h"
+#include "DMTiledLayer.h"
+#include "DMTileDirtyMap.h"
 
 namespace dm::model
 {
+	enum class HeightStorage
+	{
+		// heights as they are
+		Float32,
+		// (height - offset) / scale in 16 bits, half the memory and upload of Float32
+		UNorm16
+	};
+
+	enum class RawHeightFormat
+	{
+		// .r32, one float per texel
+		R32Float,
+		// .r16, one unsigned 16 bit value per texel, read as [0, 1]
+		R16UNorm
+	};
+
+	// a headerless width * width raster, heights are value * scale + offset
+	struct RawHeightLayout
+	{
+		RawHeightFormat format = RawHeightFormat::R32Float;
+		// the first width values are the first column instead of the first row
+		bool columnMajor = false;
+		float scale = 1.f;
+		float offset = 0.f;
+	};
+
+	// unit normal in two bytes. the upper half of an octahedron, turned 45 degrees so it covers the whole [-1, 1] square:
+	// u, v = x, y / 127, p = ((u + v) / 2, (u - v) / 2), normal = normalize(p.x, 1 - |p.x| - |p.y|, p.y)
+	struct PackedNormal
+	{
+		int8_t x;
+		int8_t y;
+	};
+
+	// central differences over [x0, x1) * [z0, z1) of a width * width grid of T, decoded as value * decodeScale, into the
+	// same texels of pNormals. neighbours past the edge clamp to it, up is twice the texel spacing in world units
+	template <typename T>
+	void ComputeNormals(const T* pHeights, size_t width, float decodeScale, float up, size_t x0, size_t z0, size_t x1, size_t z1, PackedNormal* pNormals);
+
 	class TerrainHeightMap
 	{
 	public:
-		TerrainHeightMap(size_t width, size_t splatWidth);
+		// worldExtent is the world space size of the square the heights cover, starting at the origin
+		TerrainHeightMap(size_t width, size_t splatWidth, float worldExtent = defaultWorldExtent);
+
+		static constexpr float defaultWorldExtent = 5120.f;
+
+		// overlay and splat only, for a map whose heights are paged in from elsewhere. GetWidth still reports the width
+		// of the heights, anything that reads or writes them throws
+		static TerrainHeightMap WithoutHeights(size_t width, size_t splatWidth, float worldExtent);
+		bool HasHeights() const { return _hasHeights; }
+
+		// heights and normals are each one contiguous, cache line aligned block, rows are packed back to back.
+		// only the height view matching GetHeightStorage is valid, GetTexelHeight/SetHeights work with either
+		core::GridView<const float> GetHeights() const { return { _heightMap.data(), _width, _width }; }
+		core::GridView<const uint16_t> GetQuantizedHeights() const { return { _quantizedHeights.data(), _width, _width }; }
+		// as of the last UpdateNormals
+		core::GridView<const PackedNormal> GetNormals() const { return { _normalMap.data(), _width, _width }; }
+		// overlay and splat are copy on write tiles, writes through these clone whatever a snapshot still holds
+		TiledLayer<DMR8G8B8A8Pixel>& GetOverlay() { return _overlay; }
+		const TiledLayer<DMR8G8B8A8Pixel>& GetOverlay() const { return _overlay; }
+		TiledLayer<DMR8G8B8A8Pixel>& GetSplat() { return _splat; }
+		const TiledLayer<DMR8G8B8A8Pixel>& GetSplat() const { return _splat; }
+
+		HeightStorage GetHeightStorage() const { return _storage; }
+		// UNorm16 decodes as value / 65535 * scale + offset, Float32 has scale 1 and offset 0
+		float GetHeightScale() const { return _heightScale; }
+		float GetHeightOffset() const { return _heightOffset; }
+		// converts the stored heights and returns the largest error the conversion introduced.
+		// UNorm16 covers [minHeight, maxHeight] and clamps heights outside it, without a range it fits the current heights
+		float SetHeightStorage(HeightStorage storage, float minHeight, float maxHeight);
+		float SetHeightStorage(HeightStorage storage);
+		// lowest and highest stored height
+		std::pair<float, float> GetHeightRange() const;
+
+		float GetTexelHeight(size_t x, size_t z) const
+		{
+			if (_storage == HeightStorage::Float32)
+				return _heightMap[z * _width + x];
+
+			return _quantizedHeights[z * _width + x] * (_heightScale / 65535.f) + _heightOffset;
+		}
+
+		// writes heights with its top left texel at x/z, encoding for the current storage, and marks the region dirty
+		void SetHeights(size_t x, size_t z, core::GridView<const float> heights);
+		// replaces the whole map with heights that are already encoded, switching to UNorm16 with exactly this scale and offset
+		void SetQuantizedHeights(core::GridView<const uint16_t> heights, float scale, float offset);
+		// replaces every height with a raster the size of the map in a single parallel pass. UNorm16 storage keeps its
+		// scale and offset like SetHeights does, refit it with SetHeightStorage afterwards if the range changed
+		void ImportRawHeights(std::span<const char> raw, const RawHeightLayout& layout);
+		void ImportRawHeights(core::FileSystem* fileSystem, const std::string& path, const RawHeightLayout& layout);
+
+		// recomputes the normals next to heights written since the last call, one task per tile, and marks what it
+		// rewrote in normalMapDirty. returns the number of tiles it recomputed
+		size_t UpdateNormals();
+
 
-		std::vector<std::vector<float>>& GetFloatData();
-		std::vector<std::vector<DMR8G8B8A8Pixel>>& GetOverlayData();
-		std::vector<std::vector<DMR8G8B8A8Pixel>>& GetSplatData();
 		void ClearOverlay(DMR8G8B8A8Pixel color);
+		// fills [x, x + w) * [z, z + h) of the overlay
+		void FillOverlay(size_t x, size_t z, size_t w, size_t h, DMR8G8B8A8Pixel color);
+		// bilinear height at world x/z, positions outside the map are clamped to its edge
 		float GetHeight(float x, float z) const;
+		// GetHeight for every (x, z) in positions, several at a time where the CPU allows it
+		void SampleHeights(std::span<const glm::vec2> positions, std::span<float> heights) const;
 		size_t GetWidth() const { return _width; }
+		float GetWorldExtent() const { return _worldExtent; }
 		size_t GetSplatWidth() const { return _splatWidth; }
 
-		bool heightMapDirty = true;
-		bool overlayDirty = true;
-		bool splatDirty = true;
+		// height and normal tiles written since the last snapshot. overlay and splat need none, a written tile is a new tile
+		TileDirtyMap heightMapDirty;
+		TileDirtyMap normalMapDirty;
 	private:
+		// marks heights written in [x, x + w) * [z, z + h) for snapshots and normals
+		void MarkHeights(size_t x, size_t z, size_t w, size_t h);
+		void MarkAllHeights();
+		void RequireHeights(const char* pCaller) const;
+
 		size_t _width, _splatWidth;
-		std::vector<std::vector<float>> _heightMap;
-		std::vector<std::vector<DMR8G8B8A8Pixel>> _heightMapOverlay;
-		std::vector<std::vector<DMR8G8B8A8Pixel>> _heightMapSplat;
+		float _worldExtent;
+		bool _hasHeights = true;
+		HeightStorage _storage = HeightStorage::Float32;
+		float _heightScale = 1.f;
+		float _heightOffset = 0.f;
+		core::AlignedBuffer<float> _heightMap;
+		// one element longer than the map, the AVX2 sampler gathers 32 bits at 16 bit offsets
+		core::AlignedBuffer<uint16_t> _quantizedHeights;
+		core::AlignedBuffer<PackedNormal> _normalMap;
+		// tiles whose normals are out of date, a height also changes the normals of its four neighbours
+		TileDirtyMap _staleNormals;
+		TiledLayer<DMR8G8B8A8Pixel> _overlay;
+		TiledLayer<DMR8G8B8A8Pixel> _splat;
 	};
 }
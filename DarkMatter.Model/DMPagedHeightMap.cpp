@@ -0,0 +1,406 @@
+#include "pch.h"
+#include "DMPagedHeightMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "DMParallel.h"
+#include "DMTaskSystem.h"
+
+namespace dm::model
+{
+	namespace
+	{
+		constexpr size_t pageSize = PagedHeightMap::pageSize;
+
+		template <typename T>
+		std::shared_ptr<const std::vector<T>> ReadPage(const TerrainFileReader& reader, size_t tileX, size_t tileZ)
+		{
+			const auto bytes = reader.GetTileBytes(TerrainFileLayer::Heights, tileX, tileZ);
+			auto page = std::make_shared<std::vector<T>>(bytes / sizeof(T));
+			reader.ReadTile(TerrainFileLayer::Heights, tileX, tileZ, std::span(reinterpret_cast<char*>(page->data()), bytes));
+			return page;
+		}
+
+		template <typename T>
+		void AddFlatTile(std::vector<std::shared_ptr<const std::vector<T>>>& flats, size_t texels)
+		{
+			if (std::ranges::none_of(flats, [texels](const auto& pTile) { return pTile->size() == texels; }))
+				flats.push_back(std::make_shared<const std::vector<T>>(texels));
+		}
+
+		template <typename T>
+		const std::shared_ptr<const std::vector<T>>& FlatTile(const std::vector<std::shared_ptr<const std::vector<T>>>& flats, size_t texels)
+		{
+			return *std::ranges::find_if(flats, [texels](const auto& pTile) { return pTile->size() == texels; });
+		}
+
+		// normals of page pageX/pageZ of a width * width map. tileOf(page) is the heights of a resident page, nullptr for
+		// any other. the page is copied into a grid with a one texel border taken from the resident neighbours and
+		// clamped to the page where there's none, so ComputeNormals never has to look past the copy
+		template <typename T, typename TileOf>
+		std::shared_ptr<const std::vector<PackedNormal>> PageNormals(const TileOf& tileOf, size_t pageX, size_t pageZ, size_t pagesPerRow, size_t width, float decodeScale, float up)
+		{
+			const auto tileWidth = [width](size_t page) { return std::min(pageSize, width - page * pageSize); };
+			const auto columns = tileWidth(pageX);
+			const auto rows = tileWidth(pageZ);
+			const auto& own = *tileOf(pageZ * pagesPerRow + pageX);
+
+			const auto texel = [&](ptrdiff_t x, ptrdiff_t z)
+				{
+					if (x < 0 || z < 0 || x >= static_cast<ptrdiff_t>(columns) || z >= static_cast<ptrdiff_t>(rows))
+					{
+						const auto mapX = static_cast<ptrdiff_t>(pageX * pageSize) + x;
+						const auto mapZ = static_cast<ptrdiff_t>(pageZ * pageSize) + z;
+						if (mapX >= 0 && mapZ >= 0 && mapX < static_cast<ptrdiff_t>(width) && mapZ < static_cast<ptrdiff_t>(width))
+						{
+							const auto neighbourX = static_cast<size_t>(mapX) / pageSize;
+							const auto neighbourZ = static_cast<size_t>(mapZ) / pageSize;
+							if (const auto* pNeighbour = tileOf(neighbourZ * pagesPerRow + neighbourX))
+								return (*pNeighbour)[(static_cast<size_t>(mapZ) % pageSize) * tileWidth(neighbourX) + static_cast<size_t>(mapX) % pageSize];
+						}
+
+						x = std::clamp<ptrdiff_t>(x, 0, columns - 1);
+						z = std::clamp<ptrdiff_t>(z, 0, rows - 1);
+					}
+
+					return own[z * columns + x];
+				};
+
+			constexpr auto gridWidth = pageSize + 2;
+			std::vector<T> grid(gridWidth * gridWidth);
+			for (size_t z = 0; z < rows + 2; z++)
+			{
+				for (size_t x = 0; x < columns + 2; x++)
+				{
+					grid[z * gridWidth + x] = texel(static_cast<ptrdiff_t>(x) - 1, static_cast<ptrdiff_t>(z) - 1);
+				}
+			}
+
+			std::vector<PackedNormal> gridNormals(gridWidth * gridWidth);
+			ComputeNormals(grid.data(), gridWidth, decodeScale, up, 1, 1, columns + 1, rows + 1, gridNormals.data());
+
+			auto normals = std::make_shared<std::vector<PackedNormal>>(columns * rows);
+			for (size_t z = 0; z < rows; z++)
+			{
+				std::copy_n(&gridNormals[(z + 1) * gridWidth + 1], columns, &(*normals)[z * columns]);
+			}
+
+			return normals;
+		}
+	}
+
+	std::unique_ptr<PagedHeightMap> PagedHeightMap::Open(core::FileSystem* fileSystem, const std::string& path, size_t maxResidentPages)
+	{
+		auto reader = std::make_shared<const TerrainFileReader>(fileSystem, path);
+		if (reader->GetHeader().tileSize != pageSize)
+			throw std::runtime_error(std::format("Terrain file has {} texel tiles, pages are {}: {}", reader->GetHeader().tileSize, pageSize, path));
+
+		return std::unique_ptr<PagedHeightMap>(new PagedHeightMap(std::move(reader), path, maxResidentPages));
+	}
+
+	PagedHeightMap::PagedHeightMap(std::shared_ptr<const TerrainFileReader> reader, std::string path, size_t maxResidentPages)
+		: _reader(std::move(reader)), _path(std::move(path)), _maxResidentPages(maxResidentPages)
+	{
+		const auto& header = _reader->GetHeader();
+		_width = header.width;
+		_pagesPerRow = _reader->GetTilesPerRow(TerrainFileLayer::Heights);
+		_worldExtent = header.worldExtent;
+		_storage = header.heightStorage;
+		_heightScale = header.heightScale;
+		_heightOffset = header.heightOffset;
+		_pages = std::vector<Page>(_pagesPerRow * _pagesPerRow);
+
+		// full pages, the short ones along the last row and column, and the corner
+		if (_pagesPerRow == 0)
+			return;
+
+		for (const auto pageZ : { size_t{ 0 }, _pagesPerRow - 1 })
+		{
+			for (const auto pageX : { size_t{ 0 }, _pagesPerRow - 1 })
+			{
+				const auto texels = TileWidth(pageX) * TileWidth(pageZ);
+				AddFlatTile(_flatHeights, texels);
+				AddFlatTile(_flatQuantizedHeights, texels);
+				AddFlatTile(_flatNormals, texels);
+			}
+		}
+	}
+
+	void PagedHeightMap::UpdateResidency(glm::vec2 position, float radius)
+	{
+		_frame++;
+		TakeLoadedPages();
+
+		if (_width < 2)
+			return;
+
+		const auto pageExtent = _worldExtent * static_cast<float>(pageSize) / static_cast<float>(_width - 1);
+		const auto lastPage = static_cast<float>(_pagesPerRow - 1);
+		const auto firstX = static_cast<size_t>(std::clamp(std::floor((position.x - radius) / pageExtent), 0.f, lastPage));
+		const auto lastX = static_cast<size_t>(std::clamp(std::floor((position.x + radius) / pageExtent), 0.f, lastPage));
+		const auto firstZ = static_cast<size_t>(std::clamp(std::floor((position.y - radius) / pageExtent), 0.f, lastPage));
+		const auto lastZ = static_cast<size_t>(std::clamp(std::floor((position.y + radius) / pageExtent), 0.f, lastPage));
+
+		_wanted.clear();
+		for (size_t pageZ = firstZ; pageZ <= lastZ; pageZ++)
+		{
+			for (size_t pageX = firstX; pageX <= lastX; pageX++)
+			{
+				const auto dx = (static_cast<float>(pageX) + 0.5f) * pageExtent - position.x;
+				const auto dz = (static_cast<float>(pageZ) + 0.5f) * pageExtent - position.y;
+				_wanted.push_back({ .distance = dx * dx + dz * dz, .index = pageZ * _pagesPerRow + pageX });
+			}
+		}
+
+		// a radius wider than the budget only gets the pages nearest the point
+		const auto count = std::min(_wanted.size(), _maxResidentPages);
+		std::partial_sort(_wanted.begin(), _wanted.begin() + count, _wanted.end(),
+			[](const WantedPage& a, const WantedPage& b) { return a.distance < b.distance; });
+		_wanted.resize(count);
+
+		// farthest first, so the nearest pages end up at the front of the LRU list
+		size_t toLoad = 0;
+		for (auto it = _wanted.rbegin(); it != _wanted.rend(); ++it)
+		{
+			auto& page = _pages[it->index];
+			page.wantedFrame = _frame;
+			if (page.state == PageState::Resident)
+				_lru.splice(_lru.begin(), _lru, page.lru);
+			else if (page.state == PageState::NotResident)
+				toLoad++;
+		}
+
+		Evict(toLoad);
+
+		// loads count against the budget from the moment they start, pages that don't fit wait for a later update
+		for (const auto& wanted : _wanted)
+		{
+			if (_stats.residentPages + _stats.loadingPages >= _maxResidentPages)
+				break;
+
+			if (_pages[wanted.index].state == PageState::NotResident)
+				Load(wanted.index);
+		}
+	}
+
+	void PagedHeightMap::TakeLoadedPages()
+	{
+		std::vector<size_t> arrived;
+		LoadedPage loaded;
+		while (_loaded->try_dequeue(loaded))
+		{
+			auto& page = _pages[loaded.index];
+			_stats.loadingPages--;
+
+			if (loaded.heights == nullptr && loaded.quantizedHeights == nullptr)
+			{
+				page.state = PageState::Missing;
+				_stats.failedLoads++;
+				continue;
+			}
+
+			page.state = PageState::Resident;
+			page.heights = std::move(loaded.heights);
+			page.quantizedHeights = std::move(loaded.quantizedHeights);
+			// the page was wanted when it was requested, it starts out as recent as that
+			page.lru = _lru.insert(_lru.begin(), loaded.index);
+			_stats.residentPages++;
+			_stats.residentBytes += PageBytes(loaded.index);
+			_stats.loads++;
+			arrived.push_back(loaded.index);
+		}
+
+		if (arrived.empty())
+			return;
+
+		// the edges of a new page change the normals along the edges of its resident neighbours, those are redone too
+		std::vector<size_t> stale;
+		for (const auto index : arrived)
+		{
+			const auto pageX = index % _pagesPerRow;
+			const auto pageZ = index / _pagesPerRow;
+			stale.push_back(index);
+			if (pageX > 0)
+				stale.push_back(index - 1);
+			if (pageX + 1 < _pagesPerRow)
+				stale.push_back(index + 1);
+			if (pageZ > 0)
+				stale.push_back(index - _pagesPerRow);
+			if (pageZ + 1 < _pagesPerRow)
+				stale.push_back(index + _pagesPerRow);
+		}
+
+		std::erase_if(stale, [this](size_t index) { return _pages[index].state != PageState::Resident; });
+		std::ranges::sort(stale);
+		stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+
+		std::vector<std::shared_ptr<const std::vector<PackedNormal>>> normals(stale.size());
+		core::task::parallel_for({ .begin = 0, .end = stale.size() }, 1, [&](core::task::Range range)
+			{
+				for (size_t i = range.begin; i < range.end; i++)
+				{
+					normals[i] = ComputePageNormals(stale[i]);
+				}
+			});
+
+		for (size_t i = 0; i < stale.size(); i++)
+		{
+			_pages[stale[i]].normals = std::move(normals[i]);
+		}
+	}
+
+	void PagedHeightMap::Load(size_t index)
+	{
+		_pages[index].state = PageState::Loading;
+		_stats.loadingPages++;
+
+		// tiles decode independently, each straight out of the mapped file on a background worker
+		core::task::GTaskSystem->async_([reader = _reader, loaded = _loaded, index, tileX = index % _pagesPerRow, tileZ = index / _pagesPerRow]
+			{
+				LoadedPage page{ .index = index };
+				try
+				{
+					if (reader->GetHeader().heightStorage == HeightStorage::Float32)
+						page.heights = ReadPage<float>(*reader, tileX, tileZ);
+					else
+						page.quantizedHeights = ReadPage<uint16_t>(*reader, tileX, tileZ);
+				}
+				catch (...)
+				{
+					// a tile that doesn't decode is the same as a missing one, the owner decides what that means
+				}
+
+				loaded->enqueue(std::move(page));
+			}, core::task::Priority::Background);
+	}
+
+	void PagedHeightMap::Evict(size_t toLoad)
+	{
+		// in flight pages can't be evicted but still count, the wanted pages alone never go over budget
+		while (_stats.residentPages > 0 && _stats.residentPages + _stats.loadingPages + toLoad > _maxResidentPages)
+		{
+			const auto index = _lru.back();
+			auto& page = _pages[index];
+			if (page.wantedFrame == _frame)
+				break;
+
+			_lru.pop_back();
+			page.state = PageState::NotResident;
+			page.heights.reset();
+			page.quantizedHeights.reset();
+			page.normals.reset();
+			_stats.residentPages--;
+			_stats.residentBytes -= PageBytes(index);
+			_stats.evictions++;
+		}
+	}
+
+	std::shared_ptr<const std::vector<PackedNormal>> PagedHeightMap::ComputePageNormals(size_t index) const
+	{
+		const auto pageX = index % _pagesPerRow;
+		const auto pageZ = index / _pagesPerRow;
+		if (_width < 2)
+			return FlatTile(_flatNormals, TileWidth(pageX) * TileWidth(pageZ));
+
+		const auto up = 2.f * _worldExtent / static_cast<float>(_width - 1);
+		if (_storage == HeightStorage::Float32)
+		{
+			const auto tileOf = [this](size_t page) { return _pages[page].state == PageState::Resident ? _pages[page].heights.get() : nullptr; };
+			return PageNormals<float>(tileOf, pageX, pageZ, _pagesPerRow, _width, 1.f, up);
+		}
+
+		const auto tileOf = [this](size_t page) { return _pages[page].state == PageState::Resident ? _pages[page].quantizedHeights.get() : nullptr; };
+		return PageNormals<uint16_t>(tileOf, pageX, pageZ, _pagesPerRow, _width, _heightScale / 65535.f, up);
+	}
+
+	size_t PagedHeightMap::PageBytes(size_t index) const
+	{
+		const auto texels = TileWidth(index % _pagesPerRow) * TileWidth(index / _pagesPerRow);
+		const auto heightBytes = _storage == HeightStorage::Float32 ? sizeof(float) : sizeof(uint16_t);
+		return texels * (heightBytes + sizeof(PackedNormal));
+	}
+
+	std::optional<float> PagedHeightMap::TryGetTexelHeight(size_t x, size_t z) const
+	{
+		if (x >= _width || z >= _width)
+			return std::nullopt;
+
+		const auto& page = _pages[(z / pageSize) * _pagesPerRow + x / pageSize];
+		if (page.state != PageState::Resident)
+			return std::nullopt;
+
+		const auto texel = (z % pageSize) * TileWidth(x / pageSize) + x % pageSize;
+		if (_storage == HeightStorage::Float32)
+			return (*page.heights)[texel];
+
+		return (*page.quantizedHeights)[texel] * (_heightScale / 65535.f) + _heightOffset;
+	}
+
+	std::optional<float> PagedHeightMap::TryGetHeight(float x, float z) const
+	{
+		if (_width == 0)
+			return std::nullopt;
+
+		// same texel mapping as TerrainHeightMap::SampleHeights
+		const auto texelsPerUnit = static_cast<float>(_width - 1) / _worldExtent;
+		const auto texX = std::clamp(x, 0.f, _worldExtent) * texelsPerUnit;
+		const auto texZ = std::clamp(z, 0.f, _worldExtent) * texelsPerUnit;
+
+		const auto x0 = std::min(static_cast<size_t>(texX), _width - 1);
+		const auto z0 = std::min(static_cast<size_t>(texZ), _width - 1);
+		const auto x1 = std::min(x0 + 1, _width - 1);
+		const auto z1 = std::min(z0 + 1, _width - 1);
+		const auto fracX = texX - static_cast<float>(x0);
+		const auto fracZ = texZ - static_cast<float>(z0);
+
+		const auto h00 = TryGetTexelHeight(x0, z0);
+		const auto h10 = TryGetTexelHeight(x1, z0);
+		const auto h01 = TryGetTexelHeight(x0, z1);
+		const auto h11 = TryGetTexelHeight(x1, z1);
+		if (!h00 || !h10 || !h01 || !h11)
+			return std::nullopt;
+
+		const auto h0 = *h00 * (1.f - fracX) + *h10 * fracX;
+		const auto h1 = *h01 * (1.f - fracX) + *h11 * fracX;
+		return h0 * (1.f - fracZ) + h1 * fracZ;
+	}
+
+	void PagedHeightMap::SampleHeights(std::span<const glm::vec2> positions, std::span<float> heights) const
+	{
+		if (positions.size() != heights.size())
+			throw std::invalid_argument("PagedHeightMap::SampleHeights: positions and heights must be the same length");
+
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			heights[i] = TryGetHeight(positions[i].x, positions[i].y).value_or(std::numeric_limits<float>::quiet_NaN());
+		}
+	}
+
+	std::shared_ptr<const std::vector<float>> PagedHeightMap::ShareHeightTile(size_t page) const
+	{
+		if (_pages[page].state == PageState::Resident && _pages[page].heights != nullptr)
+			return _pages[page].heights;
+
+		return FlatTile(_flatHeights, TileWidth(page % _pagesPerRow) * TileWidth(page / _pagesPerRow));
+	}
+
+	std::shared_ptr<const std::vector<uint16_t>> PagedHeightMap::ShareQuantizedHeightTile(size_t page) const
+	{
+		if (_pages[page].state == PageState::Resident && _pages[page].quantizedHeights != nullptr)
+			return _pages[page].quantizedHeights;
+
+		return FlatTile(_flatQuantizedHeights, TileWidth(page % _pagesPerRow) * TileWidth(page / _pagesPerRow));
+	}
+
+	std::shared_ptr<const std::vector<PackedNormal>> PagedHeightMap::ShareNormalTile(size_t page) const
+	{
+		if (_pages[page].state == PageState::Resident && _pages[page].normals != nullptr)
+			return _pages[page].normals;
+
+		return FlatTile(_flatNormals, TileWidth(page % _pagesPerRow) * TileWidth(page / _pagesPerRow));
+	}
+}
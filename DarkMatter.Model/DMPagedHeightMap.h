@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "concurrentqueue.h"
+#include "DMFileSystem.h"
+#include "DMHeightMap.h"
+#include "DMTerrainFile.h"
+
+namespace dm::model
+{
+	struct PagedHeightMapStats
+	{
+		size_t residentPages = 0;
+		size_t loadingPages = 0;
+		// heights and normals of the resident pages
+		size_t residentBytes = 0;
+		uint64_t loads = 0;
+		uint64_t evictions = 0;
+		// pages whose tile didn't decode, they read as no data
+		uint64_t failedLoads = 0;
+	};
+
+	// Heights for worlds too big to keep in memory, read straight out of a .dmt file. A page is one height tile of the
+	// file, so pages are the snapshot's tiles as well, and only the pages around a point of interest are resident. Tiles
+	// are decoded on the task system and handed back to the owner, which computes their normals when they arrive.
+	// Resident and in flight pages together never go over maxResidentPages, the nearest wanted pages are loaded first and
+	// the least recently wanted ones are evicted first. Everything but the decodes happens on the thread calling
+	// UpdateResidency, reads are for that thread too.
+	class PagedHeightMap
+	{
+	public:
+		static constexpr size_t pageSize = TileDirtyMap::tileSize;
+
+		// throws if path isn't a terrain file or its tiles aren't pageSize
+		static std::unique_ptr<PagedHeightMap> Open(core::FileSystem* fileSystem, const std::string& path, size_t maxResidentPages);
+
+		// requests the pages within radius (world units) of position, nearest first and no more than the budget holds,
+		// takes in finished loads and evicts pages that aren't wanted any more while over budget
+		void UpdateResidency(glm::vec2 position, float radius);
+
+		// nullopt while the page holding the texel isn't resident
+		std::optional<float> TryGetTexelHeight(size_t x, size_t z) const;
+		// bilinear, like TerrainHeightMap::GetHeight. nullopt unless all four texels are resident
+		std::optional<float> TryGetHeight(float x, float z) const;
+		// TryGetHeight for every (x, z) in positions, NaN where it would be nullopt
+		void SampleHeights(std::span<const glm::vec2> positions, std::span<float> heights) const;
+
+		// the page's tiles for snapshots. pages that aren't resident read as flat ground until they are
+		std::shared_ptr<const std::vector<float>> ShareHeightTile(size_t page) const;
+		std::shared_ptr<const std::vector<uint16_t>> ShareQuantizedHeightTile(size_t page) const;
+		std::shared_ptr<const std::vector<PackedNormal>> ShareNormalTile(size_t page) const;
+
+		const std::string& GetPath() const { return _path; }
+		size_t GetWidth() const { return _width; }
+		float GetWorldExtent() const { return _worldExtent; }
+		// as saved in the file, see TerrainHeightMap
+		HeightStorage GetHeightStorage() const { return _storage; }
+		float GetHeightScale() const { return _heightScale; }
+		float GetHeightOffset() const { return _heightOffset; }
+		size_t GetPagesPerRow() const { return _pagesPerRow; }
+		PagedHeightMapStats GetStats() const { return _stats; }
+
+	private:
+		enum class PageState : uint8_t
+		{
+			NotResident,
+			Loading,
+			Resident,
+			Missing
+		};
+
+		struct Page
+		{
+			PageState state = PageState::NotResident;
+			// one of the two, whichever the file stores
+			std::shared_ptr<const std::vector<float>> heights;
+			std::shared_ptr<const std::vector<uint16_t>> quantizedHeights;
+			std::shared_ptr<const std::vector<PackedNormal>> normals;
+			// position in _lru while resident
+			std::list<size_t>::iterator lru;
+			// last UpdateResidency that wanted the page, those are never evicted by the same update
+			uint64_t wantedFrame = 0;
+		};
+
+		struct LoadedPage
+		{
+			size_t index;
+			// both nullptr if the tile couldn't be decoded
+			std::shared_ptr<const std::vector<float>> heights;
+			std::shared_ptr<const std::vector<uint16_t>> quantizedHeights;
+		};
+
+		struct WantedPage
+		{
+			// squared distance from the point of interest to the page's centre
+			float distance;
+			size_t index;
+		};
+
+		// decodes outlive the map if it goes away while they're in flight, so the reader and the queue they report to are shared
+		using LoadedQueue = moodycamel::ConcurrentQueue<LoadedPage>;
+
+		PagedHeightMap(std::shared_ptr<const TerrainFileReader> reader, std::string path, size_t maxResidentPages);
+
+		size_t TileWidth(size_t pageX) const { return std::min(pageSize, _width - pageX * pageSize); }
+
+		void TakeLoadedPages();
+		void Load(size_t index);
+		// makes room for toLoad more pages by evicting resident ones that weren't wanted this update
+		void Evict(size_t toLoad);
+		// normals of a resident page, from its own heights and the edges of whichever neighbours are resident
+		std::shared_ptr<const std::vector<PackedNormal>> ComputePageNormals(size_t index) const;
+		size_t PageBytes(size_t index) const;
+
+		std::shared_ptr<const TerrainFileReader> _reader;
+		std::string _path;
+		size_t _width;
+		size_t _pagesPerRow;
+		float _worldExtent;
+		HeightStorage _storage;
+		float _heightScale;
+		float _heightOffset;
+		size_t _maxResidentPages;
+
+		// the page table, one entry per page of the whole map whether it's resident or not
+		std::vector<Page> _pages;
+		// resident pages, most recently wanted first
+		std::list<size_t> _lru;
+		// this update's wanted pages, kept to reuse the allocation
+		std::vector<WantedPage> _wanted;
+		// shared flat tiles for pages that aren't resident, one per texel count like TiledLayer's defaults
+		std::vector<std::shared_ptr<const std::vector<float>>> _flatHeights;
+		std::vector<std::shared_ptr<const std::vector<uint16_t>>> _flatQuantizedHeights;
+		std::vector<std::shared_ptr<const std::vector<PackedNormal>>> _flatNormals;
+		std::shared_ptr<LoadedQueue> _loaded = std::make_shared<LoadedQueue>();
+		uint64_t _frame = 0;
+		PagedHeightMapStats _stats;
+	};
+}
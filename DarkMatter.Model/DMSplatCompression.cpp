@@ -0,0 +1,407 @@
+#include "pch.h"
+#include "DMSplatCompression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "DMCpuFeatures.h"
+#include "DMTerrainKernels.h"
+
+namespace dm::model
+{
+	namespace
+	{
+		// mode 6 interpolation weights out of 64. symmetric, so swapping the endpoints mirrors the indices
+		constexpr int32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// a block's texels in row order, one array per channel
+		struct BlockTexels
+		{
+			alignas(32) int32_t channels[4][16];
+		};
+
+		// endpoints as they're stored, 8 bits per channel with the lowest bit being the endpoint's p bit
+		struct BlockFit
+		{
+			int32_t e0[4];
+			int32_t e1[4];
+			uint8_t indices[16];
+			uint32_t squaredError = UINT32_MAX;
+			int32_t maxError = INT32_MAX;
+		};
+
+		bool Better(const BlockFit& a, const BlockFit& b)
+		{
+			return a.maxError < b.maxError || (a.maxError == b.maxError && a.squaredError < b.squaredError);
+		}
+
+		int32_t Interpolate(int32_t e0, int32_t e1, int32_t weight)
+		{
+			return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+		}
+
+		// gives every texel the palette entry closest to it, ties going to the lower index, and measures the result.
+		// integer only, so the AVX2 path and the scalar one pick the same indices
+		void FitIndices(const BlockTexels& texels, BlockFit& fit)
+		{
+			alignas(32) int32_t palette[4][16];
+			for (size_t c = 0; c < 4; c++)
+			{
+				for (size_t i = 0; i < 16; i++)
+				{
+					palette[c][i] = Interpolate(fit.e0[c], fit.e1[c], weights[i]);
+				}
+			}
+
+#if defined(_M_X64) || defined(__x86_64__)
+			if (core::HasAvx2())
+			{
+				kernels::FitIndicesAvx2(&texels.channels[0][0], &palette[0][0], fit.indices, fit.squaredError, fit.maxError);
+				return;
+			}
+#endif
+
+			fit.squaredError = 0;
+			fit.maxError = 0;
+			for (size_t t = 0; t < 16; t++)
+			{
+				int32_t best = INT32_MAX;
+				int32_t bestIndex = 0;
+				for (int32_t i = 0; i < 16; i++)
+				{
+					int32_t distance = 0;
+					for (size_t c = 0; c < 4; c++)
+					{
+						const auto d = texels.channels[c][t] - palette[c][i];
+						distance += d * d;
+					}
+
+					if (distance < best)
+					{
+						best = distance;
+						bestIndex = i;
+					}
+				}
+
+				fit.indices[t] = static_cast<uint8_t>(bestIndex);
+				fit.squaredError += best;
+				for (size_t c = 0; c < 4; c++)
+				{
+					fit.maxError = std::max(fit.maxError, std::abs(palette[c][bestIndex] - texels.channels[c][t]));
+				}
+			}
+		}
+
+		// the closest stored endpoint with that p bit
+		int32_t Quantize(float value, int32_t pBit)
+		{
+			return std::clamp(static_cast<int32_t>(std::nearbyint((value - static_cast<float>(pBit)) * 0.5f)), 0, 127) * 2 + pBit;
+		}
+
+		// tries the four p bit combinations on float endpoints, best keeps whichever fits best so far
+		void FitEndpoints(const BlockTexels& texels, const float (&e0)[4], const float (&e1)[4], BlockFit& best)
+		{
+			for (int32_t pBits = 0; pBits < 4; pBits++)
+			{
+				BlockFit fit;
+				for (size_t c = 0; c < 4; c++)
+				{
+					fit.e0[c] = Quantize(e0[c], pBits & 1);
+					fit.e1[c] = Quantize(e1[c], pBits >> 1);
+				}
+
+				FitIndices(texels, fit);
+				if (Better(fit, best))
+					best = fit;
+			}
+		}
+
+		// the ends of the texels' principal axis, the line through them that's closest to all of them
+		void PrincipalLine(const BlockTexels& texels, float (&e0)[4], float (&e1)[4])
+		{
+			float mean[4] = {};
+			for (size_t c = 0; c < 4; c++)
+			{
+				for (size_t t = 0; t < 16; t++)
+				{
+					mean[c] += static_cast<float>(texels.channels[c][t]);
+				}
+				mean[c] /= 16.f;
+			}
+
+			float covariance[4][4] = {};
+			float axis[4] = {};
+			float farthest = 0.f;
+			for (size_t t = 0; t < 16; t++)
+			{
+				float d[4];
+				float length = 0.f;
+				for (size_t c = 0; c < 4; c++)
+				{
+					d[c] = static_cast<float>(texels.channels[c][t]) - mean[c];
+					length += d[c] * d[c];
+				}
+
+				for (size_t a = 0; a < 4; a++)
+				{
+					for (size_t b = 0; b < 4; b++)
+					{
+						covariance[a][b] += d[a] * d[b];
+					}
+				}
+
+				// power iteration starts from the texel farthest from the mean, a range vector can be orthogonal to the
+				// axis when two channels blend against each other
+				if (length > farthest)
+				{
+					farthest = length;
+					std::copy_n(d, 4, axis);
+				}
+			}
+
+			for (size_t iteration = 0; iteration < 8 && farthest > 0.f; iteration++)
+			{
+				float next[4] = {};
+				float length = 0.f;
+				for (size_t a = 0; a < 4; a++)
+				{
+					for (size_t b = 0; b < 4; b++)
+					{
+						next[a] += covariance[a][b] * axis[b];
+					}
+					length += next[a] * next[a];
+				}
+
+				if (length < 1e-12f)
+					break;
+
+				const auto scale = 1.f / std::sqrt(length);
+				for (size_t c = 0; c < 4; c++)
+				{
+					axis[c] = next[c] * scale;
+				}
+			}
+
+			float low = 0.f;
+			float high = 0.f;
+			for (size_t t = 0; t < 16; t++)
+			{
+				float projection = 0.f;
+				for (size_t c = 0; c < 4; c++)
+				{
+					projection += (static_cast<float>(texels.channels[c][t]) - mean[c]) * axis[c];
+				}
+				low = std::min(low, projection);
+				high = std::max(high, projection);
+			}
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				e0[c] = std::clamp(mean[c] + axis[c] * low, 0.f, 255.f);
+				e1[c] = std::clamp(mean[c] + axis[c] * high, 0.f, 255.f);
+			}
+		}
+
+		// the endpoints that fit the texels best for the indices they already have, by least squares. false if every
+		// texel uses the same weight, there's no line to fit then
+		bool RefitEndpoints(const BlockTexels& texels, const uint8_t (&indices)[16], float (&e0)[4], float (&e1)[4])
+		{
+			float aa = 0.f, ab = 0.f, bb = 0.f;
+			float ax[4] = {}, bx[4] = {};
+			for (size_t t = 0; t < 16; t++)
+			{
+				const auto b = static_cast<float>(weights[indices[t]]) / 64.f;
+				const auto a = 1.f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (size_t c = 0; c < 4; c++)
+				{
+					ax[c] += a * static_cast<float>(texels.channels[c][t]);
+					bx[c] += b * static_cast<float>(texels.channels[c][t]);
+				}
+			}
+
+			const auto determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f)
+				return false;
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.f, 255.f);
+				e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.f, 255.f);
+			}
+			return true;
+		}
+
+		// 128 bits, least significant bit of bits[0] first
+		struct BitWriter
+		{
+			uint64_t bits[2] = {};
+			size_t position = 0;
+
+			void Put(uint64_t value, size_t count)
+			{
+				const auto word = position / 64;
+				const auto shift = position % 64;
+				bits[word] |= value << shift;
+				if (shift + count > 64)
+					bits[word + 1] |= value >> (64 - shift);
+				position += count;
+			}
+		};
+
+		struct BitReader
+		{
+			const uint64_t* bits;
+			size_t position = 0;
+
+			uint32_t Get(size_t count)
+			{
+				const auto word = position / 64;
+				const auto shift = position % 64;
+				auto value = bits[word] >> shift;
+				if (shift + count > 64)
+					value |= bits[word + 1] << (64 - shift);
+				position += count;
+				return static_cast<uint32_t>(value & ((uint64_t{ 1 } << count) - 1));
+			}
+		};
+
+		SplatBlock Pack(BlockFit fit)
+		{
+			// the first texel's index is stored without its top bit, so it has to be below 8
+			if (fit.indices[0] >= 8)
+			{
+				std::swap(fit.e0, fit.e1);
+				for (auto& index : fit.indices)
+				{
+					index = static_cast<uint8_t>(15 - index);
+				}
+			}
+
+			// mode 6 is a 1 in bit 6, then R0 R1 G0 G1 B0 B1 A0 A1 in 7 bits, the two p bits and the indices
+			BitWriter writer;
+			writer.Put(uint64_t{ 1 } << 6, 7);
+			for (size_t c = 0; c < 4; c++)
+			{
+				writer.Put(static_cast<uint64_t>(fit.e0[c] >> 1), 7);
+				writer.Put(static_cast<uint64_t>(fit.e1[c] >> 1), 7);
+			}
+			writer.Put(static_cast<uint64_t>(fit.e0[0] & 1), 1);
+			writer.Put(static_cast<uint64_t>(fit.e1[0] & 1), 1);
+			writer.Put(fit.indices[0], 3);
+			for (size_t t = 1; t < 16; t++)
+			{
+				writer.Put(fit.indices[t], 4);
+			}
+
+			return { { writer.bits[0], writer.bits[1] } };
+		}
+
+		SplatBlock EncodeBlock(const BlockTexels& texels, uint8_t tolerance, int32_t& maxError)
+		{
+			float e0[4], e1[4];
+			BlockFit best;
+			PrincipalLine(texels, e0, e1);
+			FitEndpoints(texels, e0, e1, best);
+
+			// blocks that don't fit yet get their endpoints refit to the indices they ended up with, twice at most
+			for (size_t round = 0; round < 2 && best.maxError > tolerance; round++)
+			{
+				if (!RefitEndpoints(texels, best.indices, e0, e1))
+					break;
+
+				FitEndpoints(texels, e0, e1, best);
+			}
+
+			maxError = best.maxError;
+			return Pack(best);
+		}
+	}
+
+	uint8_t EncodeSplatTile(std::span<const DMR8G8B8A8Pixel> texels, size_t columns, size_t rows, std::span<SplatBlock> blocks, uint8_t tolerance)
+	{
+		constexpr auto blockWidth = SplatBlock::blockWidth;
+		if (columns % blockWidth != 0 || rows % blockWidth != 0 || texels.size() != columns * rows || blocks.size() != (columns / blockWidth) * (rows / blockWidth))
+			throw std::invalid_argument("EncodeSplatTile: the tile must be whole blocks and blocks must hold exactly that many");
+
+		int32_t tileError = 0;
+		// painted tiles are mostly runs of identical blocks, those reuse the block encoded before them
+		DMR8G8B8A8Pixel last[16];
+		bool haveLast = false;
+		int32_t lastError = 0;
+
+		const auto blocksPerRow = columns / blockWidth;
+		for (size_t blockZ = 0; blockZ < rows / blockWidth; blockZ++)
+		{
+			for (size_t blockX = 0; blockX < blocksPerRow; blockX++)
+			{
+				DMR8G8B8A8Pixel pixels[16];
+				for (size_t row = 0; row < blockWidth; row++)
+				{
+					std::copy_n(&texels[(blockZ * blockWidth + row) * columns + blockX * blockWidth], blockWidth, &pixels[row * blockWidth]);
+				}
+
+				auto& block = blocks[blockZ * blocksPerRow + blockX];
+				if (haveLast && memcmp(pixels, last, sizeof(pixels)) == 0)
+				{
+					block = *(&block - 1);
+					tileError = std::max(tileError, lastError);
+					continue;
+				}
+
+				BlockTexels blockTexels;
+				for (size_t t = 0; t < 16; t++)
+				{
+					blockTexels.channels[0][t] = pixels[t].r;
+					blockTexels.channels[1][t] = pixels[t].g;
+					blockTexels.channels[2][t] = pixels[t].b;
+					blockTexels.channels[3][t] = pixels[t].a;
+				}
+
+				block = EncodeBlock(blockTexels, tolerance, lastError);
+				tileError = std::max(tileError, lastError);
+				std::copy_n(pixels, 16, last);
+				haveLast = true;
+			}
+		}
+
+		return static_cast<uint8_t>(tileError);
+	}
+
+	void DecodeSplatBlock(const SplatBlock& block, std::span<DMR8G8B8A8Pixel, 16> texels)
+	{
+		BitReader reader{ block.bits };
+		if (reader.Get(7) != (1u << 6))
+			throw std::invalid_argument("DecodeSplatBlock: only mode 6 blocks are splat blocks");
+
+		int32_t e0[4], e1[4];
+		for (size_t c = 0; c < 4; c++)
+		{
+			e0[c] = static_cast<int32_t>(reader.Get(7)) << 1;
+			e1[c] = static_cast<int32_t>(reader.Get(7)) << 1;
+		}
+
+		const auto p0 = static_cast<int32_t>(reader.Get(1));
+		const auto p1 = static_cast<int32_t>(reader.Get(1));
+		for (size_t c = 0; c < 4; c++)
+		{
+			e0[c] |= p0;
+			e1[c] |= p1;
+		}
+
+		for (size_t t = 0; t < 16; t++)
+		{
+			const auto weight = weights[reader.Get(t == 0 ? 3 : 4)];
+			texels[t] = {
+				.r = static_cast<uint8_t>(Interpolate(e0[0], e1[0], weight)),
+				.g = static_cast<uint8_t>(Interpolate(e0[1], e1[1], weight)),
+				.b = static_cast<uint8_t>(Interpolate(e0[2], e1[2], weight)),
+				.a = static_cast<uint8_t>(Interpolate(e0[3], e1[3], weight)) };
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+#include "DMGraphicsPrimitives.h"
+#include "DMTileDirtyMap.h"
+
+namespace dm::model
+{
+	// One BC7 block, 4 * 4 splat texels in 16 bytes instead of 64. Always mode 6: the four weights of every texel are
+	// one of 16 steps on a line between two RGBA endpoints, which fits splat blocks well since they're mostly one
+	// material or a blend of two. The GPU samples and filters it like the RGBA8 map.
+	struct SplatBlock
+	{
+		static constexpr size_t blockWidth = 4;
+
+		uint64_t bits[2];
+	};
+
+	// blocks along a side of a splat tile
+	constexpr size_t splatBlockTileSize = TileDirtyMap::tileSize / SplatBlock::blockWidth;
+
+	// largest per channel difference, in 8 bit steps, a block may decode with before the encoder tries harder
+	constexpr uint8_t defaultSplatTolerance = 4;
+
+	// encodes a packed columns * rows splat tile, both multiples of 4, into rows / 4 rows of columns / 4 blocks.
+	// returns the largest difference of any channel of any texel between the tile and what the blocks decode to
+	uint8_t EncodeSplatTile(std::span<const DMR8G8B8A8Pixel> texels, size_t columns, size_t rows, std::span<SplatBlock> blocks,
+		uint8_t tolerance = defaultSplatTolerance);
+
+	// the texels of a block in row order, exactly as the GPU decodes them
+	void DecodeSplatBlock(const SplatBlock& block, std::span<DMR8G8B8A8Pixel, 16> texels);
+}
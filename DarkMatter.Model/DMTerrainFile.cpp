@@ -0,0 +1,588 @@
+#include "pch.h"
+#include "DMTerrainFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+#include "DMParallel.h"
+
+namespace dm::model
+{
+	namespace
+	{
+		constexpr size_t layerCount = static_cast<size_t>(TerrainFileLayer::Count);
+		constexpr uint32_t codecStored = 0;
+		constexpr uint32_t codecCompressed = 1;
+
+		// LZ blocks are sequences of [token][literal length][literals][offset][match length]. the token's high nibble is the
+		// literal count and the low nibble the match length past the minimum, 15 means more length bytes follow, each
+		// adding up to 255. the last sequence has literals only
+		constexpr size_t minMatch = 4;
+		constexpr size_t maxOffset = 65535;
+		constexpr size_t hashBits = 12;
+
+		uint32_t Load32(const uint8_t* p)
+		{
+			uint32_t value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		void WriteLength(std::vector<uint8_t>& out, size_t length)
+		{
+			for (; length >= 255; length -= 255)
+			{
+				out.push_back(255);
+			}
+			out.push_back(static_cast<uint8_t>(length));
+		}
+
+		void WriteSequence(std::vector<uint8_t>& out, const uint8_t* pLiterals, size_t literals, size_t offset, size_t match)
+		{
+			const auto matchCode = match != 0 ? match - minMatch : 0;
+			out.push_back(static_cast<uint8_t>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15)));
+			if (literals >= 15)
+				WriteLength(out, literals - 15);
+
+			out.insert(out.end(), pLiterals, pLiterals + literals);
+			if (match == 0)
+				return;
+
+			out.push_back(static_cast<uint8_t>(offset));
+			out.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15)
+				WriteLength(out, matchCode - 15);
+		}
+
+		std::vector<uint8_t> LzCompress(std::span<const uint8_t> in)
+		{
+			std::vector<uint8_t> out;
+			out.reserve(in.size() / 2);
+
+			// positions + 1, so zero is an empty slot
+			std::vector<uint32_t> table(size_t{ 1 } << hashBits);
+			size_t anchor = 0;
+			size_t i = 0;
+			while (i + minMatch <= in.size())
+			{
+				const auto sequence = Load32(&in[i]);
+				auto& slot = table[(sequence * 2654435761u) >> (32 - hashBits)];
+				const auto previous = slot;
+				const auto candidate = static_cast<size_t>(previous) - 1;
+				slot = static_cast<uint32_t>(i + 1);
+
+				if (previous == 0 || i - candidate > maxOffset || Load32(&in[candidate]) != sequence)
+				{
+					i++;
+					continue;
+				}
+
+				size_t match = minMatch;
+				while (i + match < in.size() && in[candidate + match] == in[i + match])
+				{
+					match++;
+				}
+
+				WriteSequence(out, &in[anchor], i - anchor, i - candidate, match);
+				i += match;
+				anchor = i;
+			}
+
+			WriteSequence(out, in.data() + anchor, in.size() - anchor, 0, 0);
+			return out;
+		}
+
+		size_t ReadLength(const uint8_t*& p, const uint8_t* end)
+		{
+			size_t length = 0;
+			uint8_t next;
+			do
+			{
+				if (p == end)
+					throw std::runtime_error("Terrain file block is truncated");
+				next = *p++;
+				length += next;
+			} while (next == 255);
+			return length;
+		}
+
+		// out has to be exactly the size that was compressed, anything else means the block is corrupt
+		void LzDecompress(std::span<const uint8_t> in, std::span<uint8_t> out)
+		{
+			const uint8_t* p = in.data();
+			const uint8_t* end = p + in.size();
+			size_t written = 0;
+
+			while (true)
+			{
+				if (p == end)
+					throw std::runtime_error("Terrain file block is truncated");
+
+				const auto token = *p++;
+				size_t literals = token >> 4;
+				if (literals == 15)
+					literals += ReadLength(p, end);
+
+				if (literals > static_cast<size_t>(end - p) || literals > out.size() - written)
+					throw std::runtime_error("Terrain file block has literals past its end");
+
+				memcpy(&out[written], p, literals);
+				p += literals;
+				written += literals;
+				if (p == end)
+					break;
+
+				if (end - p < 2)
+					throw std::runtime_error("Terrain file block is truncated");
+
+				const size_t offset = p[0] | (p[1] << 8);
+				p += 2;
+				size_t match = (token & 15) + minMatch;
+				if ((token & 15) == 15)
+					match += ReadLength(p, end);
+
+				if (offset == 0 || offset > written || match > out.size() - written)
+					throw std::runtime_error("Terrain file block has a match outside the tile");
+
+				// matches can overlap what they write, a run of one value is a match at offset 1
+				for (size_t b = 0; b < match; b++, written++)
+				{
+					out[written] = out[written - offset];
+				}
+			}
+
+			if (written != out.size())
+				throw std::runtime_error("Terrain file block decodes to the wrong size");
+		}
+
+		// values as Channels words of Word each, predicted per channel from the left, upper and upper left neighbours.
+		// wrapping arithmetic, so it's exact for any bit pattern including floats
+		template <typename Word, size_t Channels>
+		void Predict(const char* pValues, char* pResiduals, size_t columns, size_t rows)
+		{
+			const auto* values = reinterpret_cast<const Word*>(pValues);
+			auto* residuals = reinterpret_cast<Word*>(pResiduals);
+			const auto stride = columns * Channels;
+
+			for (size_t z = 0; z < rows; z++)
+			{
+				for (size_t i = z * stride; i < (z + 1) * stride; i++)
+				{
+					const bool hasLeft = i % stride >= Channels;
+					Word prediction = 0;
+					if (hasLeft && z > 0)
+						prediction = static_cast<Word>(values[i - Channels] + values[i - stride] - values[i - stride - Channels]);
+					else if (hasLeft)
+						prediction = values[i - Channels];
+					else if (z > 0)
+						prediction = values[i - stride];
+
+					residuals[i] = static_cast<Word>(values[i] - prediction);
+				}
+			}
+		}
+
+		template <typename Word, size_t Channels>
+		void Unpredict(const char* pResiduals, char* pValues, size_t columns, size_t rows)
+		{
+			const auto* residuals = reinterpret_cast<const Word*>(pResiduals);
+			auto* values = reinterpret_cast<Word*>(pValues);
+			const auto stride = columns * Channels;
+
+			for (size_t z = 0; z < rows; z++)
+			{
+				for (size_t i = z * stride; i < (z + 1) * stride; i++)
+				{
+					const bool hasLeft = i % stride >= Channels;
+					Word prediction = 0;
+					if (hasLeft && z > 0)
+						prediction = static_cast<Word>(values[i - Channels] + values[i - stride] - values[i - stride - Channels]);
+					else if (hasLeft)
+						prediction = values[i - Channels];
+					else if (z > 0)
+						prediction = values[i - stride];
+
+					values[i] = static_cast<Word>(residuals[i] + prediction);
+				}
+			}
+		}
+
+		struct LayerCodec
+		{
+			size_t elementSize;
+			void (*predict)(const char*, char*, size_t, size_t);
+			void (*unpredict)(const char*, char*, size_t, size_t);
+		};
+
+		constexpr LayerCodec floatCodec{ sizeof(float), Predict<uint32_t, 1>, Unpredict<uint32_t, 1> };
+		constexpr LayerCodec unorm16Codec{ sizeof(uint16_t), Predict<uint16_t, 1>, Unpredict<uint16_t, 1> };
+		// the four channels of a pixel are unrelated, each is predicted from itself
+		constexpr LayerCodec pixelCodec{ sizeof(DMR8G8B8A8Pixel), Predict<uint8_t, 4>, Unpredict<uint8_t, 4> };
+
+		const LayerCodec& CodecFor(TerrainFileLayer layer, HeightStorage storage)
+		{
+			if (layer == TerrainFileLayer::Splat)
+				return pixelCodec;
+
+			return storage == HeightStorage::Float32 ? floatCodec : unorm16Codec;
+		}
+
+		size_t TileWidth(size_t width, size_t tileSize, size_t tile)
+		{
+			return std::min(tileSize, width - tile * tileSize);
+		}
+
+		std::vector<char> EncodeTile(const LayerCodec& codec, const char* pTile, size_t columns, size_t rows, uint32_t& codecId)
+		{
+			const auto count = columns * rows;
+			const auto size = count * codec.elementSize;
+
+			std::vector<char> residuals(size);
+			codec.predict(pTile, residuals.data(), columns, rows);
+
+			// byte p of every residual goes to plane p, the high bytes of small residuals line up into runs
+			std::vector<uint8_t> planes(size);
+			for (size_t k = 0; k < count; k++)
+			{
+				for (size_t p = 0; p < codec.elementSize; p++)
+				{
+					planes[p * count + k] = static_cast<uint8_t>(residuals[k * codec.elementSize + p]);
+				}
+			}
+
+			auto compressed = LzCompress(planes);
+			if (compressed.size() >= size)
+			{
+				codecId = codecStored;
+				return { pTile, pTile + size };
+			}
+
+			codecId = codecCompressed;
+			return { compressed.begin(), compressed.end() };
+		}
+
+		void DecodeTile(const LayerCodec& codec, const TerrainFileTileEntry& entry, const char* pFile, std::span<char> out, size_t columns, size_t rows)
+		{
+			const auto* pBlock = pFile + entry.offset;
+			if (entry.codec == codecStored)
+			{
+				if (entry.size != out.size())
+					throw std::runtime_error("Terrain file stored block has the wrong size");
+
+				memcpy(out.data(), pBlock, out.size());
+				return;
+			}
+
+			const auto count = columns * rows;
+			std::vector<uint8_t> planes(out.size());
+			LzDecompress({ reinterpret_cast<const uint8_t*>(pBlock), entry.size }, planes);
+
+			std::vector<char> residuals(out.size());
+			for (size_t k = 0; k < count; k++)
+			{
+				for (size_t p = 0; p < codec.elementSize; p++)
+				{
+					residuals[k * codec.elementSize + p] = static_cast<char>(planes[p * count + k]);
+				}
+			}
+
+			codec.unpredict(residuals.data(), out.data(), columns, rows);
+		}
+
+		// a layer as bytes, either rows of width elements stride bytes apart or the tiles of a tiled layer, which are
+		// already packed the way blocks are
+		struct LayerBytes
+		{
+			size_t width;
+			const char* pData = nullptr;
+			size_t stride = 0;
+			const TiledLayer<DMR8G8B8A8Pixel>* pTiles = nullptr;
+		};
+
+		template <typename T>
+		LayerBytes AsBytes(core::GridView<const T> view)
+		{
+			return { .width = view.width, .pData = reinterpret_cast<const char*>(view.data), .stride = view.stride * sizeof(T) };
+		}
+
+		LayerBytes AsBytes(const TiledLayer<DMR8G8B8A8Pixel>& layer)
+		{
+			return { .width = layer.GetWidth(), .pTiles = &layer };
+		}
+
+		// heights and splat, or only the splat into a map without heights for worlds that page them
+		TerrainHeightMap LoadTerrain(core::FileSystem* fileSystem, const std::string& path, bool withHeights, TerrainFileStats* pStats)
+		{
+			const auto start = std::chrono::steady_clock::now();
+
+			const TerrainFileReader reader(fileSystem, path);
+			const auto& header = reader.GetHeader();
+			if (header.tileSize != TiledLayer<DMR8G8B8A8Pixel>::tileSize)
+				throw std::runtime_error("Terrain file tiles aren't the size of the map's: " + path);
+
+			auto heightMap = withHeights ? TerrainHeightMap(header.width, header.splatWidth, header.worldExtent)
+				: TerrainHeightMap::WithoutHeights(header.width, header.splatWidth, header.worldExtent);
+
+			// every tile of the layer through decodeTile(tileX, tileZ, t, scratch) on the task system. a corrupt block throws
+			// on a worker, the first error is carried back out here
+			auto decodeLayer = [&](TerrainFileLayer layer, auto&& decodeTile)
+				{
+					const auto tilesPerRow = reader.GetTilesPerRow(layer);
+					std::mutex errorMutex;
+					std::exception_ptr error;
+
+					core::task::parallel_for({ .begin = 0, .end = tilesPerRow * tilesPerRow }, 1, [&](core::task::Range tiles)
+						{
+							try
+							{
+								std::vector<char> tile;
+								for (size_t t = tiles.begin; t < tiles.end; t++)
+								{
+									decodeTile(t % tilesPerRow, t / tilesPerRow, t, tile);
+								}
+							}
+							catch (...)
+							{
+								std::lock_guard lock(errorMutex);
+								if (error == nullptr)
+									error = std::current_exception();
+							}
+						});
+
+					if (error != nullptr)
+						std::rethrow_exception(error);
+				};
+
+			// contiguous heights decode into a scratch tile that's copied into place row by row
+			auto decodeRows = [&](char* pDst, size_t elementSize)
+				{
+					return [&reader, &header, pDst, elementSize](size_t tileX, size_t tileZ, size_t, std::vector<char>& tile)
+						{
+							tile.resize(reader.GetTileBytes(TerrainFileLayer::Heights, tileX, tileZ));
+							reader.ReadTile(TerrainFileLayer::Heights, tileX, tileZ, tile);
+
+							const auto rows = TileWidth(header.width, header.tileSize, tileZ);
+							const auto rowBytes = tile.size() / rows;
+							for (size_t row = 0; row < rows; row++)
+							{
+								memcpy(pDst + ((tileZ * header.tileSize + row) * header.width + tileX * header.tileSize) * elementSize, &tile[row * rowBytes], rowBytes);
+							}
+						};
+				};
+
+			if (withHeights && header.heightStorage == HeightStorage::Float32)
+			{
+				auto heights = core::AlignedBuffer<float>::Uninitialized(header.width * header.width);
+				decodeLayer(TerrainFileLayer::Heights, decodeRows(reinterpret_cast<char*>(heights.data()), sizeof(float)));
+				heightMap.SetHeights(0, 0, core::GridView<const float>(heights.data(), header.width, header.width));
+			}
+			else if (withHeights)
+			{
+				auto heights = core::AlignedBuffer<uint16_t>::Uninitialized(header.width * header.width);
+				decodeLayer(TerrainFileLayer::Heights, decodeRows(reinterpret_cast<char*>(heights.data()), sizeof(uint16_t)));
+				heightMap.SetQuantizedHeights(core::GridView<const uint16_t>(heights.data(), header.width, header.width), header.heightScale, header.heightOffset);
+			}
+
+			// splat tiles are packed like blocks, each decodes into a tile of its own on a worker and the layer takes them
+			// here, writes to it belong to this thread. tiles that were never painted keep sharing the default, so loading
+			// keeps the splat as sparse as it was saved
+			auto& splat = heightMap.GetSplat();
+			std::vector<std::shared_ptr<TiledLayer<DMR8G8B8A8Pixel>::Tile>> splatTiles(splat.GetTilesPerRow() * splat.GetTilesPerRow());
+			decodeLayer(TerrainFileLayer::Splat, [&](size_t tileX, size_t tileZ, size_t t, std::vector<char>&)
+				{
+					auto tile = std::make_shared<TiledLayer<DMR8G8B8A8Pixel>::Tile>(splat.GetTile(t).size());
+					reader.ReadTile(TerrainFileLayer::Splat, tileX, tileZ, std::span(reinterpret_cast<char*>(tile->data()), tile->size() * sizeof(DMR8G8B8A8Pixel)));
+
+					const auto fill = splat.GetDefault();
+					if (!std::ranges::all_of(*tile, [&](const DMR8G8B8A8Pixel& pixel) { return memcmp(&pixel, &fill, sizeof(pixel)) == 0; }))
+						splatTiles[t] = std::move(tile);
+				});
+
+			for (size_t t = 0; t < splatTiles.size(); t++)
+			{
+				if (splatTiles[t] != nullptr)
+					splat.SetTile(t, std::move(splatTiles[t]));
+				else
+					splat.Reset(t);
+			}
+
+			if (pStats != nullptr)
+			{
+				const auto heightBytes = withHeights ? header.width * header.width * (header.heightStorage == HeightStorage::Float32 ? sizeof(float) : sizeof(uint16_t)) : 0;
+				pStats->rawBytes = heightBytes + header.splatWidth * header.splatWidth * sizeof(DMR8G8B8A8Pixel);
+				pStats->fileBytes = reader.GetFileBytes();
+				pStats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			return heightMap;
+		}
+	}
+
+	TerrainFileReader::TerrainFileReader(core::FileSystem* fileSystem, const std::string& path) : _file(fileSystem->MapFile(path))
+	{
+		const auto* pFile = _file->GetData();
+		const auto fileSize = _file->GetSize();
+		if (fileSize < sizeof(TerrainFileHeader))
+			throw std::runtime_error("Terrain file is too small for its header: " + path);
+
+		memcpy(&_header, pFile, sizeof(_header));
+		if (_header.magic != TerrainFileHeader::currentMagic || _header.version != TerrainFileHeader::currentVersion || _header.tileSize == 0)
+			throw std::runtime_error("Terrain file has an unknown format: " + path);
+
+		size_t indexOffset = sizeof(TerrainFileHeader);
+		for (size_t layer = 0; layer < layerCount; layer++)
+		{
+			const auto tilesPerRow = GetTilesPerRow(static_cast<TerrainFileLayer>(layer));
+			const auto tiles = tilesPerRow * tilesPerRow;
+			if (indexOffset + tiles * sizeof(TerrainFileTileEntry) > fileSize)
+				throw std::runtime_error("Terrain file index runs past its end: " + path);
+
+			_entries[layer] = reinterpret_cast<const TerrainFileTileEntry*>(pFile + indexOffset);
+			for (size_t t = 0; t < tiles; t++)
+			{
+				const auto& entry = _entries[layer][t];
+				if (entry.offset > fileSize || entry.size > fileSize - entry.offset || entry.codec > codecCompressed)
+					throw std::runtime_error("Terrain file index points outside the file: " + path);
+			}
+
+			indexOffset += tiles * sizeof(TerrainFileTileEntry);
+		}
+	}
+
+	size_t TerrainFileReader::GetLayerWidth(TerrainFileLayer layer) const
+	{
+		return layer == TerrainFileLayer::Heights ? _header.width : _header.splatWidth;
+	}
+
+	size_t TerrainFileReader::GetTilesPerRow(TerrainFileLayer layer) const
+	{
+		return (GetLayerWidth(layer) + _header.tileSize - 1) / _header.tileSize;
+	}
+
+	size_t TerrainFileReader::GetTileBytes(TerrainFileLayer layer, size_t tileX, size_t tileZ) const
+	{
+		const auto width = GetLayerWidth(layer);
+		return TileWidth(width, _header.tileSize, tileX) * TileWidth(width, _header.tileSize, tileZ) * CodecFor(layer, _header.heightStorage).elementSize;
+	}
+
+	void TerrainFileReader::ReadTile(TerrainFileLayer layer, size_t tileX, size_t tileZ, std::span<char> out) const
+	{
+		if (out.size() != GetTileBytes(layer, tileX, tileZ))
+			throw std::invalid_argument("TerrainFileReader::ReadTile: out must be exactly the tile's size");
+
+		const auto width = GetLayerWidth(layer);
+		const auto& entry = _entries[static_cast<size_t>(layer)][tileZ * GetTilesPerRow(layer) + tileX];
+		DecodeTile(CodecFor(layer, _header.heightStorage), entry, _file->GetData(), out,
+			TileWidth(width, _header.tileSize, tileX), TileWidth(width, _header.tileSize, tileZ));
+	}
+
+	TerrainFileStats SaveTerrainFile(core::FileSystem* fileSystem, const std::string& path, const TerrainHeightMap& heightMap)
+	{
+		if (!heightMap.HasHeights())
+			throw std::logic_error("SaveTerrainFile: the map's heights are paged, the file they're paged from already has them");
+
+		const auto start = std::chrono::steady_clock::now();
+
+		TerrainFileHeader header{
+			.width = heightMap.GetWidth(),
+			.splatWidth = heightMap.GetSplatWidth(),
+			.worldExtent = heightMap.GetWorldExtent(),
+			.heightStorage = heightMap.GetHeightStorage(),
+			.heightScale = heightMap.GetHeightScale(),
+			.heightOffset = heightMap.GetHeightOffset(),
+			.tileSize = static_cast<uint32_t>(TileDirtyMap::tileSize) };
+
+		const LayerBytes layers[layerCount] = {
+			header.heightStorage == HeightStorage::Float32 ? AsBytes(heightMap.GetHeights()) : AsBytes(heightMap.GetQuantizedHeights()),
+			AsBytes(heightMap.GetSplat()) };
+
+		TerrainFileStats stats;
+		std::vector<std::vector<char>> blocks[layerCount];
+		std::vector<uint32_t> codecs[layerCount];
+		for (size_t l = 0; l < layerCount; l++)
+		{
+			const auto& layer = layers[l];
+			const auto& codec = CodecFor(static_cast<TerrainFileLayer>(l), header.heightStorage);
+			const auto tilesPerRow = (layer.width + header.tileSize - 1) / header.tileSize;
+			blocks[l].resize(tilesPerRow * tilesPerRow);
+			codecs[l].resize(tilesPerRow * tilesPerRow);
+			stats.rawBytes += layer.width * layer.width * codec.elementSize;
+
+			core::task::parallel_for({ .begin = 0, .end = blocks[l].size() }, 1, [&](core::task::Range tiles)
+				{
+					std::vector<char> tile;
+					for (size_t t = tiles.begin; t < tiles.end; t++)
+					{
+						const auto tileX = t % tilesPerRow;
+						const auto tileZ = t / tilesPerRow;
+						const auto columns = TileWidth(layer.width, header.tileSize, tileX);
+						const auto rows = TileWidth(layer.width, header.tileSize, tileZ);
+						const auto rowBytes = columns * codec.elementSize;
+
+						if (layer.pTiles != nullptr)
+						{
+							blocks[l][t] = EncodeTile(codec, reinterpret_cast<const char*>(layer.pTiles->GetTile(t).data()), columns, rows, codecs[l][t]);
+							continue;
+						}
+
+						tile.resize(rows * rowBytes);
+						for (size_t row = 0; row < rows; row++)
+						{
+							memcpy(&tile[row * rowBytes], layer.pData + (tileZ * header.tileSize + row) * layer.stride + tileX * header.tileSize * codec.elementSize, rowBytes);
+						}
+
+						blocks[l][t] = EncodeTile(codec, tile.data(), columns, rows, codecs[l][t]);
+					}
+				});
+		}
+
+		// header, every index, then the blocks in the same order
+		size_t size = sizeof(TerrainFileHeader);
+		for (size_t l = 0; l < layerCount; l++)
+		{
+			size += blocks[l].size() * sizeof(TerrainFileTileEntry);
+		}
+
+		std::vector<TerrainFileTileEntry> entries;
+		for (size_t l = 0; l < layerCount; l++)
+		{
+			for (size_t t = 0; t < blocks[l].size(); t++)
+			{
+				entries.push_back({ .offset = size, .size = static_cast<uint32_t>(blocks[l][t].size()), .codec = codecs[l][t] });
+				size += blocks[l][t].size();
+			}
+		}
+
+		std::vector<char> file(size);
+		memcpy(file.data(), &header, sizeof(header));
+		memcpy(file.data() + sizeof(header), entries.data(), entries.size() * sizeof(TerrainFileTileEntry));
+		size_t e = 0;
+		for (size_t l = 0; l < layerCount; l++)
+		{
+			for (const auto& block : blocks[l])
+			{
+				memcpy(file.data() + entries[e++].offset, block.data(), block.size());
+			}
+		}
+
+		fileSystem->WriteFile(path, file.data(), file.size(), false);
+
+		stats.fileBytes = file.size();
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return stats;
+	}
+
+	TerrainHeightMap LoadTerrainFile(core::FileSystem* fileSystem, const std::string& path, TerrainFileStats* pStats)
+	{
+		return LoadTerrain(fileSystem, path, true, pStats);
+	}
+
+	TerrainHeightMap LoadTerrainFileWithoutHeights(core::FileSystem* fileSystem, const std::string& path, TerrainFileStats* pStats)
+	{
+		return LoadTerrain(fileSystem, path, false, pStats);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "DMFileSystem.h"
+#include "DMHeightMap.h"
+
+namespace dm::model
+{
+	// .dmt terrain files. A header, one index per layer, then every 64 * 64 tile of the layer as its own block, so tiles
+	// encode and decode independently and any one of them can be read without touching the rest. A block is the tile's
+	// rows with each value predicted from its left, upper and upper left neighbours, the residuals split into byte
+	// planes and the planes LZ compressed. Blocks that don't get smaller are stored as they are.
+	enum class TerrainFileLayer : uint32_t
+	{
+		// float or UNorm16 values, whichever the map stored
+		Heights,
+		Splat,
+		Count
+	};
+
+	struct TerrainFileHeader
+	{
+		static constexpr uint32_t currentMagic = 0x52544d44; // "DMTR"
+		static constexpr uint32_t currentVersion = 1;
+
+		uint32_t magic = currentMagic;
+		uint32_t version = currentVersion;
+		uint64_t width = 0;
+		uint64_t splatWidth = 0;
+		float worldExtent = 0.f;
+		HeightStorage heightStorage = HeightStorage::Float32;
+		float heightScale = 1.f;
+		float heightOffset = 0.f;
+		uint32_t tileSize = 0;
+		// spells out what would otherwise be padding, so the header goes to disk without indeterminate bytes
+		uint32_t reserved = 0;
+	};
+	static_assert(sizeof(TerrainFileHeader) == 48, "TerrainFileHeader must not have padding");
+
+	// one per tile, right after the header, layer by layer
+	struct TerrainFileTileEntry
+	{
+		uint64_t offset;
+		uint32_t size;
+		// 0 stored as is, 1 predicted, byte planed and LZ compressed
+		uint32_t codec;
+	};
+
+	struct TerrainFileStats
+	{
+		size_t rawBytes = 0;
+		size_t fileBytes = 0;
+		double milliseconds = 0.0;
+	};
+
+	// maps a .dmt file and decodes tiles out of it on request, safe to read tiles from several threads at once
+	class TerrainFileReader
+	{
+	public:
+		// throws if the file isn't a terrain file this version understands or its index points outside it
+		TerrainFileReader(core::FileSystem* fileSystem, const std::string& path);
+
+		const TerrainFileHeader& GetHeader() const { return _header; }
+		size_t GetLayerWidth(TerrainFileLayer layer) const;
+		size_t GetTilesPerRow(TerrainFileLayer layer) const;
+		size_t GetFileBytes() const { return _file->GetSize(); }
+		// the tile's rows packed back to back, edge tiles are cut short like snapshot tiles
+		size_t GetTileBytes(TerrainFileLayer layer, size_t tileX, size_t tileZ) const;
+
+		// out must be exactly GetTileBytes long
+		void ReadTile(TerrainFileLayer layer, size_t tileX, size_t tileZ, std::span<char> out) const;
+
+	private:
+		std::unique_ptr<core::MappedFile> _file;
+		TerrainFileHeader _header;
+		const TerrainFileTileEntry* _entries[static_cast<size_t>(TerrainFileLayer::Count)] = {};
+	};
+
+	// encodes every tile of the heights and splat on the task system and writes the file in one go
+	TerrainFileStats SaveTerrainFile(core::FileSystem* fileSystem, const std::string& path, const TerrainHeightMap& heightMap);
+	// decodes every tile on the task system into a new map, heights come back bit for bit in the storage they were saved in
+	TerrainHeightMap LoadTerrainFile(core::FileSystem* fileSystem, const std::string& path, TerrainFileStats* pStats = nullptr);
+	// only the splat, into TerrainHeightMap::WithoutHeights, for worlds whose heights are paged out of the same file
+	TerrainHeightMap LoadTerrainFileWithoutHeights(core::FileSystem* fileSystem, const std::string& path, TerrainFileStats* pStats = nullptr);
+}
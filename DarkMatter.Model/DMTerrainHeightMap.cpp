@@ -1,95 +1,518 @@
 #include "pch.h"
 #include "DMHeightMap.h"
 
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "DMCpuFeatures.h"
+#include "DMParallel.h"
+#include "DMTerrainKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 namespace dm::model
 {
-	TerrainHeightMap::TerrainHeightMap(size_t width, size_t splatWidth)
+	namespace
 	{
-        _width = width;
-        _splatWidth = splatWidth;
-		_heightMap = std::vector<std::vector<float>>(width);
-        _heightMapOverlay = std::vector<std::vector<DMR8G8B8A8Pixel>>(width);
-        _heightMapSplat = std::vector<std::vector<DMR8G8B8A8Pixel>>(splatWidth);
+		// bilinear samples of a width * width grid of T, decoded as value * decodeScale + decodeOffset
+		template <typename T>
+		void SampleTexels(const T* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+			std::span<const glm::vec2> positions, std::span<float> heights)
+		{
+			const auto width = static_cast<int32_t>(mapWidth);
+			const float texelsPerUnit = static_cast<float>(mapWidth - 1) / worldExtent;
+			size_t i = 0;
+
+			// every path below does the same math as the scalar tail: clamp to the map, scale to texels, truncate, then
+			// lerp along x and z. coordinates are never negative after the clamp, so truncating is flooring
+#if defined(_M_X64) || defined(__x86_64__)
+			if (core::HasAvx2())
+			{
+				i = kernels::SampleTexelsAvx2(pHeights, mapWidth, worldExtent, decodeScale, decodeOffset,
+					reinterpret_cast<const float*>(positions.data()), positions.size(), heights.data());
+			}
+			else
+			{
+				// SSE2 has no gather or 32 bit multiply, the texel math is vectorized and the four corners are fetched per lane
+				const __m128 extent = _mm_set1_ps(worldExtent);
+				const __m128 scale = _mm_set1_ps(texelsPerUnit);
+				const __m128 one = _mm_set1_ps(1.f);
+				const __m128i lastTexel = _mm_set1_epi32(width - 1);
+				const __m128 decodeScaleV = _mm_set1_ps(decodeScale);
+				const __m128 decodeOffsetV = _mm_set1_ps(decodeOffset);
+
+				for (; i + 4 <= positions.size(); i += 4)
+				{
+					const __m128 a = _mm_loadu_ps(&positions[i].x);
+					const __m128 b = _mm_loadu_ps(&positions[i + 2].x);
+					const __m128 xs = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+					const __m128 zs = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+					const __m128 texX = _mm_mul_ps(_mm_min_ps(_mm_max_ps(xs, _mm_setzero_ps()), extent), scale);
+					const __m128 texZ = _mm_mul_ps(_mm_min_ps(_mm_max_ps(zs, _mm_setzero_ps()), extent), scale);
+					__m128i x0 = _mm_cvttps_epi32(texX);
+					__m128i z0 = _mm_cvttps_epi32(texZ);
+					// no _mm_min_epi32 before SSE4.1, clamp with a compare and blend
+					const __m128i xOver = _mm_cmpgt_epi32(x0, lastTexel);
+					const __m128i zOver = _mm_cmpgt_epi32(z0, lastTexel);
+					x0 = _mm_or_si128(_mm_and_si128(xOver, lastTexel), _mm_andnot_si128(xOver, x0));
+					z0 = _mm_or_si128(_mm_and_si128(zOver, lastTexel), _mm_andnot_si128(zOver, z0));
+					const __m128i x1 = _mm_sub_epi32(x0, _mm_cmplt_epi32(x0, lastTexel));
+					const __m128i z1 = _mm_sub_epi32(z0, _mm_cmplt_epi32(z0, lastTexel));
+					const __m128 fracX = _mm_sub_ps(texX, _mm_cvtepi32_ps(x0));
+					const __m128 fracZ = _mm_sub_ps(texZ, _mm_cvtepi32_ps(z0));
+
+					alignas(16) int32_t cx0[4], cx1[4], cz0[4], cz1[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(cx0), x0);
+					_mm_store_si128(reinterpret_cast<__m128i*>(cx1), x1);
+					_mm_store_si128(reinterpret_cast<__m128i*>(cz0), z0);
+					_mm_store_si128(reinterpret_cast<__m128i*>(cz1), z1);
+
+					alignas(16) float c00[4], c10[4], c01[4], c11[4];
+					for (int lane = 0; lane < 4; lane++)
+					{
+						const T* row0 = pHeights + static_cast<size_t>(cz0[lane]) * mapWidth;
+						const T* row1 = pHeights + static_cast<size_t>(cz1[lane]) * mapWidth;
+						c00[lane] = static_cast<float>(row0[cx0[lane]]);
+						c10[lane] = static_cast<float>(row0[cx1[lane]]);
+						c01[lane] = static_cast<float>(row1[cx0[lane]]);
+						c11[lane] = static_cast<float>(row1[cx1[lane]]);
+					}
+
+					const __m128 invX = _mm_sub_ps(one, fracX);
+					const __m128 h0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c00), invX), _mm_mul_ps(_mm_load_ps(c10), fracX));
+					const __m128 h1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c01), invX), _mm_mul_ps(_mm_load_ps(c11), fracX));
+					const __m128 h = _mm_add_ps(_mm_mul_ps(h0, _mm_sub_ps(one, fracZ)), _mm_mul_ps(h1, fracZ));
+					_mm_storeu_ps(&heights[i], _mm_add_ps(_mm_mul_ps(h, decodeScaleV), decodeOffsetV));
+				}
+			}
+#endif
+
+			for (; i < positions.size(); i++)
+			{
+				const float texX = std::clamp(positions[i].x, 0.f, worldExtent) * texelsPerUnit;
+				const float texZ = std::clamp(positions[i].y, 0.f, worldExtent) * texelsPerUnit;
+
+				const int32_t x0 = std::min(static_cast<int32_t>(texX), width - 1);
+				const int32_t z0 = std::min(static_cast<int32_t>(texZ), width - 1);
+				const int32_t x1 = x0 < width - 1 ? x0 + 1 : x0;
+				const int32_t z1 = z0 < width - 1 ? z0 + 1 : z0;
+				const float fracX = texX - static_cast<float>(x0);
+				const float fracZ = texZ - static_cast<float>(z0);
+
+				const T* row0 = pHeights + static_cast<size_t>(z0) * mapWidth;
+				const T* row1 = pHeights + static_cast<size_t>(z1) * mapWidth;
+				const float h0 = static_cast<float>(row0[x0]) * (1.f - fracX) + static_cast<float>(row0[x1]) * fracX;
+				const float h1 = static_cast<float>(row1[x0]) * (1.f - fracX) + static_cast<float>(row1[x1]) * fracX;
+				heights[i] = (h0 * (1.f - fracZ) + h1 * fracZ) * decodeScale + decodeOffset;
+			}
+		}
 
-		for (size_t i = 0; i < width; i++)
+		// where imported heights end up, the float map or the 16 bit encoding of it
+		struct HeightTarget
 		{
-            _heightMap[i] = std::vector<float>(width);
-            _heightMapOverlay[i] = std::vector<DMR8G8B8A8Pixel>(width);
+			float* pHeights;
+			uint16_t* pQuantized;
+			float encodeScale;
+			float encodeOffset;
+
+			void Store(size_t index, float height) const
+			{
+				if (pHeights != nullptr)
+				{
+					pHeights[index] = height;
+					return;
+				}
+
+				const auto normalized = std::clamp((height - encodeOffset) * encodeScale, 0.f, 65535.f);
+				pQuantized[index] = static_cast<uint16_t>(normalized + 0.5f);
+			}
+		};
+
+		PackedNormal PackNormal(float dX, float dZ, float up)
+		{
+			// the normal is (-dX, up, -dZ), projected onto the octahedron by dividing by its L1 norm
+			const float invLength = 1.f / (std::abs(dX) + up + std::abs(dZ));
+			const float px = -dX * invLength;
+			const float pz = -dZ * invLength;
+			return { static_cast<int8_t>(std::nearbyint((px + pz) * 127.f)), static_cast<int8_t>(std::nearbyint((px - pz) * 127.f)) };
 		}
 
-        for (size_t i = 0; i < splatWidth; i++)
-        {
-            _heightMapSplat[i] = std::vector<DMR8G8B8A8Pixel>(splatWidth);
+		// decodes a width * width raster as value * scale + offset, transposing it on the way if it's column major.
+		// 8 rows at a time, so a column major source is read in 8 * 8 blocks that are transposed in registers
+		template <typename T>
+		void ConvertRaster(const T* pRaw, size_t width, bool columnMajor, float scale, float offset, const HeightTarget& target)
+		{
+			core::task::parallel_for({ .begin = 0, .end = (width + 7) / 8 }, 4, [&](core::task::Range blocks)
+				{
+					for (size_t block = blocks.begin; block < blocks.end; block++)
+					{
+						const auto z0 = block * 8;
+						const auto rows = std::min<size_t>(8, width - z0);
+						size_t x = 0;
+#if defined(_M_X64) || defined(__x86_64__)
+						if (rows == 8 && core::HasAvx2())
+						{
+							x = kernels::ConvertRowsAvx2(pRaw, width, columnMajor, z0, scale, offset,
+								target.pHeights, target.pQuantized, target.encodeScale, target.encodeOffset);
+						}
+#endif
+						for (size_t z = z0; z < z0 + rows; z++)
+						{
+							for (size_t column = x; column < width; column++)
+							{
+								const auto value = columnMajor ? pRaw[column * width + z] : pRaw[z * width + column];
+								target.Store(z * width + column, static_cast<float>(value) * scale + offset);
+							}
+						}
+					}
+				});
+		}
+	}
 
-            for (size_t j = 0; j < splatWidth; j++)
-            {
-                _heightMapSplat[i][j] = DMR8G8B8A8Pixel{ .r = 255, .g = 0, .b = 0, .a = 0 };
-            }
-        }
+	template <typename T>
+	void ComputeNormals(const T* pHeights, size_t width, float decodeScale, float up, size_t x0, size_t z0, size_t x1, size_t z1, PackedNormal* pNormals)
+	{
+		for (size_t z = z0; z < z1; z++)
+		{
+			const T* row = pHeights + z * width;
+			const T* rowDown = pHeights + (z > 0 ? z - 1 : 0) * width;
+			const T* rowUp = pHeights + (z + 1 < width ? z + 1 : z) * width;
+			PackedNormal* normals = pNormals + z * width;
+
+			auto computeOne = [&](size_t x)
+				{
+					const auto left = x > 0 ? x - 1 : 0;
+					const auto right = x + 1 < width ? x + 1 : x;
+					const float dX = (static_cast<float>(row[right]) - static_cast<float>(row[left])) * decodeScale;
+					const float dZ = (static_cast<float>(rowUp[x]) - static_cast<float>(rowDown[x])) * decodeScale;
+					normals[x] = PackNormal(dX, dZ, up);
+				};
+
+			size_t x = x0;
+			if (x == 0 && x < x1)
+				computeOne(x++);
+
+#if defined(_M_X64) || defined(__x86_64__)
+			if (x < x1 && core::HasAvx2())
+			{
+				static_assert(sizeof(PackedNormal) == sizeof(uint16_t));
+				x = kernels::ComputeNormalsRowAvx2(row, rowDown, rowUp, width, x, x1, decodeScale, up, reinterpret_cast<uint16_t*>(normals));
+			}
+#endif
+			for (; x < x1; x++)
+			{
+				computeOne(x);
+			}
+		}
 	}
 
-	std::vector<std::vector<float>>& TerrainHeightMap::GetFloatData()
+	template void ComputeNormals(const float*, size_t, float, float, size_t, size_t, size_t, size_t, PackedNormal*);
+	template void ComputeNormals(const uint16_t*, size_t, float, float, size_t, size_t, size_t, size_t, PackedNormal*);
+
+	TerrainHeightMap::TerrainHeightMap(size_t width, size_t splatWidth, float worldExtent)
 	{
-		return _heightMap;
+        _width = width;
+        _splatWidth = splatWidth;
+        _worldExtent = worldExtent;
+        _heightMap = core::AlignedBuffer<float>(width * width);
+        // all zero is straight up, the normal of the all zero heights
+        _normalMap = core::AlignedBuffer<PackedNormal>(width * width);
+        _overlay = TiledLayer<DMR8G8B8A8Pixel>(width, {});
+        _splat = TiledLayer<DMR8G8B8A8Pixel>(splatWidth, { .r = 255, .g = 0, .b = 0, .a = 0 });
+        heightMapDirty = TileDirtyMap(width);
+        normalMapDirty = TileDirtyMap(width);
+        _staleNormals = TileDirtyMap(width, false);
 	}
 
-    std::vector<std::vector<DMR8G8B8A8Pixel>>& TerrainHeightMap::GetOverlayData()
+    TerrainHeightMap TerrainHeightMap::WithoutHeights(size_t width, size_t splatWidth, float worldExtent)
     {
-        return _heightMapOverlay;
+        TerrainHeightMap heightMap(0, splatWidth, worldExtent);
+        heightMap._width = width;
+        heightMap._hasHeights = false;
+        // the brush still paints the overlay over the whole map, it stays as sparse as what's painted
+        heightMap._overlay = TiledLayer<DMR8G8B8A8Pixel>(width, {});
+        heightMap.heightMapDirty = TileDirtyMap(width);
+        heightMap.normalMapDirty = TileDirtyMap(width);
+        heightMap._staleNormals = TileDirtyMap(width, false);
+        return heightMap;
     }
 
-    std::vector<std::vector<DMR8G8B8A8Pixel>>& TerrainHeightMap::GetSplatData()
+    void TerrainHeightMap::RequireHeights(const char* pCaller) const
     {
-        return _heightMapSplat;
+        if (!_hasHeights)
+            throw std::logic_error(std::format("{}: the map has no heights, they're paged", pCaller));
     }
 
     void TerrainHeightMap::ClearOverlay(DMR8G8B8A8Pixel color)
     {
-        // todo might be a faster way to clear this
-        for (auto& row : _heightMapOverlay)
-        {
-	        for (auto& p : row)
-	        {
-                p = color;
-	        }
-        }
+        _overlay.Fill(0, 0, _width, _width, color);
+    }
+
+    void TerrainHeightMap::FillOverlay(size_t x, size_t z, size_t w, size_t h, DMR8G8B8A8Pixel color)
+    {
+        _overlay.Fill(x, z, w, h, color);
+    }
+
+    void TerrainHeightMap::MarkHeights(size_t x, size_t z, size_t w, size_t h)
+    {
+        heightMapDirty.MarkRegion(x, z, w, h);
+        // a height also changes the normals of its four neighbours
+        _staleNormals.MarkRegion(x > 0 ? x - 1 : 0, z > 0 ? z - 1 : 0, w + (x > 0 ? 2 : 1), h + (z > 0 ? 2 : 1));
+    }
+
+    void TerrainHeightMap::MarkAllHeights()
+    {
+        heightMapDirty.MarkAll();
+        _staleNormals.MarkAll();
     }
 
 	float TerrainHeightMap::GetHeight(float x, float z) const
 	{
-        // Clamp world coordinates to [0, 5120]
-        x = (x < 0.0f) ? 0.0f : (x > 5120.0f ? 5120.0f : x);
-        z = (z < 0.0f) ? 0.0f : (z > 5120.0f ? 5120.0f : z);
-
-        // Convert to normalized texture coordinates [0, 1]
-        float u = x / 5120.0f;
-        float v = z / 5120.0f;
-
-        // Map to texture pixel coordinates
-        float texX = u * (1024 - 1);
-        float texZ = v * (1024 - 1);
-
-        // Calculate integer positions
-        int x0 = static_cast<int>(texX);
-        int x1 = (x0 < 1023) ? x0 + 1 : x0;
-        int z0 = static_cast<int>(texZ);
-        int z1 = (z0 < 1023) ? z0 + 1 : z0;
-
-        // Fractional parts for interpolation
-        float fracX = texX - x0;
-        float fracZ = texZ - z0;
-
-        // Fetch the height values from the texture data
-        float h00 = _heightMap[z0][x0];
-        float h10 = _heightMap[z0][x1];
-        float h01 = _heightMap[z1][x0];
-        float h11 = _heightMap[z1][x1];
-
-        // Bilinear interpolation
-        float h0 = h00 * (1.0f - fracX) + h10 * fracX;
-        float h1 = h01 * (1.0f - fracX) + h11 * fracX;
-        float height = h0 * (1.0f - fracZ) + h1 * fracZ;
-
+        float height;
+        const glm::vec2 position(x, z);
+        SampleHeights(std::span(&position, 1), std::span(&height, 1));
         return height;
 	}
-}
\ No newline at end of file
+
+    void TerrainHeightMap::SampleHeights(std::span<const glm::vec2> positions, std::span<float> heights) const
+    {
+        if (positions.size() != heights.size())
+            throw std::invalid_argument("SampleHeights: positions and heights must be the same length");
+
+        RequireHeights("SampleHeights");
+
+        if (_width == 0)
+        {
+            std::ranges::fill(heights, 0.f);
+            return;
+        }
+
+        if (_storage == HeightStorage::Float32)
+        {
+            SampleTexels(_heightMap.data(), _width, _worldExtent, 1.f, 0.f, positions, heights);
+        }
+        else
+        {
+            SampleTexels(_quantizedHeights.data(), _width, _worldExtent, _heightScale / 65535.f, _heightOffset, positions, heights);
+        }
+    }
+
+    std::pair<float, float> TerrainHeightMap::GetHeightRange() const
+    {
+        using Range = std::pair<float, float>;
+        const Range empty{ std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+        RequireHeights("GetHeightRange");
+
+        return core::task::parallel_reduce({ .begin = 0, .end = _width }, 16, empty, [&](core::task::Range rows)
+            {
+                Range range = empty;
+                for (size_t z = rows.begin; z < rows.end; z++)
+                {
+                    for (size_t x = 0; x < _width; x++)
+                    {
+                        const auto height = GetTexelHeight(x, z);
+                        range = { std::min(range.first, height), std::max(range.second, height) };
+                    }
+                }
+                return range;
+            },
+            [](const Range& a, const Range& b) { return Range{ std::min(a.first, b.first), std::max(a.second, b.second) }; });
+    }
+
+    float TerrainHeightMap::SetHeightStorage(HeightStorage storage)
+    {
+        const auto [minHeight, maxHeight] = _width != 0 ? GetHeightRange() : std::pair(0.f, 0.f);
+        return SetHeightStorage(storage, minHeight, maxHeight);
+    }
+
+    float TerrainHeightMap::SetHeightStorage(HeightStorage storage, float minHeight, float maxHeight)
+    {
+        RequireHeights("SetHeightStorage");
+
+        // decode everything first, then re-encode it with the new storage and parameters
+        auto heights = core::AlignedBuffer<float>::Uninitialized(_width * _width);
+        core::task::parallel_for({ .begin = 0, .end = _width }, 16, [&](core::task::Range rows)
+            {
+                for (size_t z = rows.begin; z < rows.end; z++)
+                {
+                    for (size_t x = 0; x < _width; x++)
+                    {
+                        heights[z * _width + x] = GetTexelHeight(x, z);
+                    }
+                }
+            });
+
+        _storage = storage;
+        if (storage == HeightStorage::Float32)
+        {
+            _heightScale = 1.f;
+            _heightOffset = 0.f;
+            _heightMap = core::AlignedBuffer<float>::Uninitialized(_width * _width);
+            _quantizedHeights = {};
+        }
+        else
+        {
+            // a flat map still needs a usable scale, everything encodes to 0 then
+            _heightScale = maxHeight > minHeight ? maxHeight - minHeight : 1.f;
+            _heightOffset = minHeight;
+            _heightMap = {};
+            _quantizedHeights = core::AlignedBuffer<uint16_t>(_width * _width + 1);
+        }
+
+        SetHeights(0, 0, core::GridView<const float>(heights.data(), _width, _width));
+
+        return core::task::parallel_reduce({ .begin = 0, .end = _width }, 16, 0.f, [&](core::task::Range rows)
+            {
+                float error = 0.f;
+                for (size_t z = rows.begin; z < rows.end; z++)
+                {
+                    for (size_t x = 0; x < _width; x++)
+                    {
+                        error = std::max(error, std::abs(GetTexelHeight(x, z) - heights[z * _width + x]));
+                    }
+                }
+                return error;
+            },
+            [](float a, float b) { return std::max(a, b); });
+    }
+
+    void TerrainHeightMap::SetHeights(size_t x, size_t z, core::GridView<const float> heights)
+    {
+        RequireHeights("SetHeights");
+
+        const auto w = std::min(heights.width, _width - std::min(x, _width));
+        const auto h = std::min(heights.height, _width - std::min(z, _width));
+
+        core::task::parallel_for({ .begin = 0, .end = h }, 16, [&](core::task::Range rows)
+            {
+                for (size_t row = rows.begin; row < rows.end; row++)
+                {
+                    const auto source = heights.Row(row).first(w);
+                    const auto offset = (z + row) * _width + x;
+
+                    if (_storage == HeightStorage::Float32)
+                    {
+                        std::ranges::copy(source, _heightMap.data() + offset);
+                        continue;
+                    }
+
+                    const auto encode = 65535.f / _heightScale;
+                    for (size_t column = 0; column < w; column++)
+                    {
+                        const auto normalized = std::clamp((source[column] - _heightOffset) * encode, 0.f, 65535.f);
+                        _quantizedHeights[offset + column] = static_cast<uint16_t>(normalized + 0.5f);
+                    }
+                }
+            });
+
+        MarkHeights(x, z, w, h);
+    }
+
+    void TerrainHeightMap::SetQuantizedHeights(core::GridView<const uint16_t> heights, float scale, float offset)
+    {
+        if (heights.width != _width || heights.height != _width)
+            throw std::invalid_argument("SetQuantizedHeights: heights must cover the whole map");
+
+        RequireHeights("SetQuantizedHeights");
+
+        _storage = HeightStorage::UNorm16;
+        _heightScale = scale;
+        _heightOffset = offset;
+        _heightMap = {};
+        if (_quantizedHeights.size() != _width * _width + 1)
+            _quantizedHeights = core::AlignedBuffer<uint16_t>(_width * _width + 1);
+
+        core::task::parallel_for({ .begin = 0, .end = _width }, 16, [&](core::task::Range rows)
+            {
+                for (size_t row = rows.begin; row < rows.end; row++)
+                {
+                    std::ranges::copy(heights.Row(row), _quantizedHeights.data() + row * _width);
+                }
+            });
+
+        MarkAllHeights();
+    }
+
+    size_t TerrainHeightMap::UpdateNormals()
+    {
+        if (!_staleNormals.Any())
+            return 0;
+
+        std::vector<size_t> tiles;
+        const auto tilesPerRow = _staleNormals.GetTilesPerRow();
+        for (size_t t = 0; t < tilesPerRow * tilesPerRow; t++)
+        {
+            if (_staleNormals.IsDirty(t))
+                tiles.push_back(t);
+        }
+        _staleNormals.Clear();
+
+        if (_width < 2)
+            return 0;
+
+        const auto up = 2.f * _worldExtent / static_cast<float>(_width - 1);
+        core::task::parallel_for({ .begin = 0, .end = tiles.size() }, 1, [&](core::task::Range range)
+            {
+                for (size_t i = range.begin; i < range.end; i++)
+                {
+                    const auto x0 = (tiles[i] % tilesPerRow) * TileDirtyMap::tileSize;
+                    const auto z0 = (tiles[i] / tilesPerRow) * TileDirtyMap::tileSize;
+                    const auto x1 = std::min(x0 + TileDirtyMap::tileSize, _width);
+                    const auto z1 = std::min(z0 + TileDirtyMap::tileSize, _width);
+
+                    if (_storage == HeightStorage::Float32)
+                    {
+                        ComputeNormals(_heightMap.data(), _width, 1.f, up, x0, z0, x1, z1, _normalMap.data());
+                    }
+                    else
+                    {
+                        ComputeNormals(_quantizedHeights.data(), _width, _heightScale / 65535.f, up, x0, z0, x1, z1, _normalMap.data());
+                    }
+                }
+            });
+
+        for (const auto tile : tiles)
+        {
+            normalMapDirty.MarkRegion((tile % tilesPerRow) * TileDirtyMap::tileSize, (tile / tilesPerRow) * TileDirtyMap::tileSize, TileDirtyMap::tileSize, TileDirtyMap::tileSize);
+        }
+
+        return tiles.size();
+    }
+
+    void TerrainHeightMap::ImportRawHeights(std::span<const char> raw, const RawHeightLayout& layout)
+    {
+        RequireHeights("ImportRawHeights");
+
+        const auto texelSize = layout.format == RawHeightFormat::R32Float ? sizeof(float) : sizeof(uint16_t);
+        if (raw.size() != _width * _width * texelSize)
+            throw std::invalid_argument(std::format("ImportRawHeights: expected {} bytes for a {} * {} raster, got {}", _width * _width * texelSize, _width, _width, raw.size()));
+
+        const auto target = _storage == HeightStorage::Float32
+            ? HeightTarget{ .pHeights = _heightMap.data(), .pQuantized = nullptr, .encodeScale = 0.f, .encodeOffset = 0.f }
+            : HeightTarget{ .pHeights = nullptr, .pQuantized = _quantizedHeights.data(), .encodeScale = 65535.f / _heightScale, .encodeOffset = _heightOffset };
+
+        if (layout.format == RawHeightFormat::R32Float)
+        {
+            ConvertRaster(reinterpret_cast<const float*>(raw.data()), _width, layout.columnMajor, layout.scale, layout.offset, target);
+        }
+        else
+        {
+            ConvertRaster(reinterpret_cast<const uint16_t*>(raw.data()), _width, layout.columnMajor, layout.scale / 65535.f, layout.offset, target);
+        }
+
+        MarkAllHeights();
+    }
+
+    void TerrainHeightMap::ImportRawHeights(core::FileSystem* fileSystem, const std::string& path, const RawHeightLayout& layout)
+    {
+        // converted straight out of the mapping, the file is never copied as a whole
+        const auto file = fileSystem->MapFile(path);
+        ImportRawHeights(std::span(file->GetData(), file->GetSize()), layout);
+    }
+}
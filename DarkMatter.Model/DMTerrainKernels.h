@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// AVX2 versions of the hot terrain loops, heightmap and splat map. They're in DMTerrainKernelsAvx2.cpp, the one file of
+// the library built with AVX2, so everything else still runs on any x64 CPU. Only call them when core::HasAvx2() is true.
+// The ones over a range work through as much of it as fills whole vectors and return where they stopped, the caller
+// finishes the rest with its portable path.
+namespace dm::model::kernels
+{
+	// bilinear samples for count interleaved x, z positions, see SampleTexels in DMTerrainHeightMap.cpp
+	size_t SampleTexelsAvx2(const float* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+		const float* pPositions, size_t count, float* pOut);
+	size_t SampleTexelsAvx2(const uint16_t* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+		const float* pPositions, size_t count, float* pOut);
+
+	// the 8 rows of a width * width raster from row z0, decoded as value * scale + offset and stored into pHeights, or if
+	// that's null encoded into pQuantized as (height - encodeOffset) * encodeScale. see ConvertRaster
+	size_t ConvertRowsAvx2(const float* pRaw, size_t width, bool columnMajor, size_t z0, float scale, float offset,
+		float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset);
+	size_t ConvertRowsAvx2(const uint16_t* pRaw, size_t width, bool columnMajor, size_t z0, float scale, float offset,
+		float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset);
+
+	// packed normals for [x0, x1) of one row of a width * width grid, x0 > 0. pNormals is the row's PackedNormals as
+	// x | y << 8. see ComputeNormals
+	size_t ComputeNormalsRowAvx2(const float* pRow, const float* pRowDown, const float* pRowUp, size_t width, size_t x0, size_t x1,
+		float decodeScale, float up, uint16_t* pNormals);
+	size_t ComputeNormalsRowAvx2(const uint16_t* pRow, const uint16_t* pRowDown, const uint16_t* pRowUp, size_t width, size_t x0, size_t x1,
+		float decodeScale, float up, uint16_t* pNormals);
+
+	// the closest of a BC7 mode 6 block's 16 palette entries for each of its 16 texels, ties going to the lower index, with
+	// the summed squared distance and the largest per channel error. pTexels and pPalette are [4][16], channel major.
+	// see FitIndices in DMSplatCompression.cpp
+	void FitIndicesAvx2(const int32_t* pTexels, const int32_t* pPalette, uint8_t* pIndices, uint32_t& squaredError, int32_t& maxError);
+}
@@ -0,0 +1,299 @@
+// built with AVX2 enabled and without the precompiled header, which is built without. nothing from the standard library
+// that has inline or template code goes in here, the linker could otherwise keep this file's AVX2 copy of it for the
+// whole program
+#include "DMTerrainKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2")
+#endif
+#include <immintrin.h>
+
+namespace dm::model::kernels
+{
+	namespace
+	{
+		__m256 Gather(const float* pHeights, __m256i index)
+		{
+			return _mm256_i32gather_ps(pHeights, index, 4);
+		}
+
+		// 32 bit gathers at 16 bit offsets, the high half belongs to the next texel (or the map's padding element)
+		__m256 Gather(const uint16_t* pHeights, __m256i index)
+		{
+			const __m256i pairs = _mm256_i32gather_epi32(reinterpret_cast<const int*>(pHeights), index, 2);
+			return _mm256_cvtepi32_ps(_mm256_and_si256(pairs, _mm256_set1_epi32(0xFFFF)));
+		}
+
+		__m256 Load8(const float* pRaw)
+		{
+			return _mm256_loadu_ps(pRaw);
+		}
+
+		__m256 Load8(const uint16_t* pRaw)
+		{
+			return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pRaw))));
+		}
+
+		// rows[i] becomes column i
+		void Transpose8x8(__m256 (&rows)[8])
+		{
+			const __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+			const __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+			const __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+			const __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+			const __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+			const __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+			const __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+			const __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+			const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+			rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+			rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+			rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+			rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+			rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+			rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+			rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+			rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+		}
+
+		// same encoding as HeightTarget::Store
+		void StoreHeights(float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset, size_t index, __m256 heights)
+		{
+			if (pHeights != nullptr)
+			{
+				_mm256_storeu_ps(pHeights + index, heights);
+				return;
+			}
+
+			const __m256 scaled = _mm256_mul_ps(_mm256_sub_ps(heights, _mm256_set1_ps(encodeOffset)), _mm256_set1_ps(encodeScale));
+			const __m256 normalized = _mm256_min_ps(_mm256_max_ps(scaled, _mm256_setzero_ps()), _mm256_set1_ps(65535.f));
+			const __m256i quantized = _mm256_cvttps_epi32(_mm256_add_ps(normalized, _mm256_set1_ps(0.5f)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pQuantized + index),
+				_mm_packus_epi32(_mm256_castsi256_si128(quantized), _mm256_extracti128_si256(quantized, 1)));
+		}
+
+		// a column major source is read in 8 * 8 blocks that are transposed in registers
+		template <typename T>
+		size_t ConvertRows(const T* pRaw, size_t width, bool columnMajor, size_t z0, float scale, float offset,
+			float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset)
+		{
+			const __m256 scaleV = _mm256_set1_ps(scale);
+			const __m256 offsetV = _mm256_set1_ps(offset);
+			size_t x = 0;
+			for (; x + 8 <= width; x += 8)
+			{
+				__m256 texels[8];
+				for (size_t i = 0; i < 8; i++)
+				{
+					texels[i] = columnMajor ? Load8(pRaw + (x + i) * width + z0) : Load8(pRaw + (z0 + i) * width + x);
+				}
+
+				if (columnMajor)
+					Transpose8x8(texels);
+
+				// same mul then add as the scalar tail, no fma, so both give identical heights
+				for (size_t i = 0; i < 8; i++)
+				{
+					StoreHeights(pHeights, pQuantized, encodeScale, encodeOffset, (z0 + i) * width + x, _mm256_add_ps(_mm256_mul_ps(texels[i], scaleV), offsetV));
+				}
+			}
+
+			return x;
+		}
+
+		// same operations in the same order as PackNormal, cvtps rounds to nearest even like nearbyint
+		template <typename T>
+		size_t ComputeNormalsRow(const T* pRow, const T* pRowDown, const T* pRowUp, size_t width, size_t x0, size_t x1,
+			float decodeScale, float up, uint16_t* pNormals)
+		{
+			const __m256 signBit = _mm256_set1_ps(-0.f);
+			const __m256 decodeScaleV = _mm256_set1_ps(decodeScale);
+			const __m256 upV = _mm256_set1_ps(up);
+			const __m256 quantize = _mm256_set1_ps(127.f);
+			size_t x = x0;
+			for (; x + 8 <= x1 && x + 8 < width; x += 8)
+			{
+				const __m256 dX = _mm256_mul_ps(_mm256_sub_ps(Load8(pRow + x + 1), Load8(pRow + x - 1)), decodeScaleV);
+				const __m256 dZ = _mm256_mul_ps(_mm256_sub_ps(Load8(pRowUp + x), Load8(pRowDown + x)), decodeScaleV);
+				const __m256 length = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signBit, dX), upV), _mm256_andnot_ps(signBit, dZ));
+				const __m256 invLength = _mm256_div_ps(_mm256_set1_ps(1.f), length);
+				const __m256 px = _mm256_mul_ps(_mm256_xor_ps(dX, signBit), invLength);
+				const __m256 pz = _mm256_mul_ps(_mm256_xor_ps(dZ, signBit), invLength);
+				const __m256i u = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_add_ps(px, pz), quantize));
+				const __m256i v = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(px, pz), quantize));
+
+				// x in the low byte, y in the high byte, then narrowed to 16 bits per texel
+				const __m256i packed = _mm256_or_si256(_mm256_and_si256(u, _mm256_set1_epi32(0xFF)), _mm256_and_si256(_mm256_slli_epi32(v, 8), _mm256_set1_epi32(0xFF00)));
+				const __m256i narrowed = _mm256_permute4x64_epi64(_mm256_packus_epi32(packed, packed), _MM_SHUFFLE(3, 1, 2, 0));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pNormals + x), _mm256_castsi256_si128(narrowed));
+			}
+
+			return x;
+		}
+
+		// same math as the scalar path: clamp to the map, scale to texels, truncate, then lerp along x and z
+		template <typename T>
+		size_t SampleTexels(const T* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+			const float* pPositions, size_t count, float* pOut)
+		{
+			const auto width = static_cast<int32_t>(mapWidth);
+			const float texelsPerUnit = static_cast<float>(mapWidth - 1) / worldExtent;
+			const __m256 extent = _mm256_set1_ps(worldExtent);
+			const __m256 scale = _mm256_set1_ps(texelsPerUnit);
+			const __m256 one = _mm256_set1_ps(1.f);
+			const __m256i lastTexel = _mm256_set1_epi32(width - 1);
+			const __m256i stride = _mm256_set1_epi32(width);
+			const __m256 decodeScaleV = _mm256_set1_ps(decodeScale);
+			const __m256 decodeOffsetV = _mm256_set1_ps(decodeOffset);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				// x0 z0 .. x3 z3 and x4 z4 .. x7 z7, split into xs and zs, then undo the per 128 bit lane interleave
+				const __m256 a = _mm256_loadu_ps(pPositions + i * 2);
+				const __m256 b = _mm256_loadu_ps(pPositions + i * 2 + 8);
+				__m256 xs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+				__m256 zs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+				xs = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+				zs = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(zs), _MM_SHUFFLE(3, 1, 2, 0)));
+
+				const __m256 texX = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(xs, _mm256_setzero_ps()), extent), scale);
+				const __m256 texZ = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(zs, _mm256_setzero_ps()), extent), scale);
+				const __m256i x0 = _mm256_min_epi32(_mm256_cvttps_epi32(texX), lastTexel);
+				const __m256i z0 = _mm256_min_epi32(_mm256_cvttps_epi32(texZ), lastTexel);
+				// the compare is all ones where there's a next texel, subtracting it adds one
+				const __m256i x1 = _mm256_sub_epi32(x0, _mm256_cmpgt_epi32(lastTexel, x0));
+				const __m256i z1 = _mm256_sub_epi32(z0, _mm256_cmpgt_epi32(lastTexel, z0));
+				const __m256 fracX = _mm256_sub_ps(texX, _mm256_cvtepi32_ps(x0));
+				const __m256 fracZ = _mm256_sub_ps(texZ, _mm256_cvtepi32_ps(z0));
+
+				const __m256i row0 = _mm256_mullo_epi32(z0, stride);
+				const __m256i row1 = _mm256_mullo_epi32(z1, stride);
+				const __m256 h00 = Gather(pHeights, _mm256_add_epi32(row0, x0));
+				const __m256 h10 = Gather(pHeights, _mm256_add_epi32(row0, x1));
+				const __m256 h01 = Gather(pHeights, _mm256_add_epi32(row1, x0));
+				const __m256 h11 = Gather(pHeights, _mm256_add_epi32(row1, x1));
+
+				const __m256 invX = _mm256_sub_ps(one, fracX);
+				const __m256 h0 = _mm256_add_ps(_mm256_mul_ps(h00, invX), _mm256_mul_ps(h10, fracX));
+				const __m256 h1 = _mm256_add_ps(_mm256_mul_ps(h01, invX), _mm256_mul_ps(h11, fracX));
+				const __m256 h = _mm256_add_ps(_mm256_mul_ps(h0, _mm256_sub_ps(one, fracZ)), _mm256_mul_ps(h1, fracZ));
+				_mm256_storeu_ps(pOut + i, _mm256_add_ps(_mm256_mul_ps(h, decodeScaleV), decodeOffsetV));
+			}
+
+			return i;
+		}
+	}
+
+	size_t SampleTexelsAvx2(const float* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+		const float* pPositions, size_t count, float* pOut)
+	{
+		return SampleTexels(pHeights, mapWidth, worldExtent, decodeScale, decodeOffset, pPositions, count, pOut);
+	}
+
+	size_t SampleTexelsAvx2(const uint16_t* pHeights, size_t mapWidth, float worldExtent, float decodeScale, float decodeOffset,
+		const float* pPositions, size_t count, float* pOut)
+	{
+		return SampleTexels(pHeights, mapWidth, worldExtent, decodeScale, decodeOffset, pPositions, count, pOut);
+	}
+
+	size_t ConvertRowsAvx2(const float* pRaw, size_t width, bool columnMajor, size_t z0, float scale, float offset,
+		float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset)
+	{
+		return ConvertRows(pRaw, width, columnMajor, z0, scale, offset, pHeights, pQuantized, encodeScale, encodeOffset);
+	}
+
+	size_t ConvertRowsAvx2(const uint16_t* pRaw, size_t width, bool columnMajor, size_t z0, float scale, float offset,
+		float* pHeights, uint16_t* pQuantized, float encodeScale, float encodeOffset)
+	{
+		return ConvertRows(pRaw, width, columnMajor, z0, scale, offset, pHeights, pQuantized, encodeScale, encodeOffset);
+	}
+
+	size_t ComputeNormalsRowAvx2(const float* pRow, const float* pRowDown, const float* pRowUp, size_t width, size_t x0, size_t x1,
+		float decodeScale, float up, uint16_t* pNormals)
+	{
+		return ComputeNormalsRow(pRow, pRowDown, pRowUp, width, x0, x1, decodeScale, up, pNormals);
+	}
+
+	size_t ComputeNormalsRowAvx2(const uint16_t* pRow, const uint16_t* pRowDown, const uint16_t* pRowUp, size_t width, size_t x0, size_t x1,
+		float decodeScale, float up, uint16_t* pNormals)
+	{
+		return ComputeNormalsRow(pRow, pRowDown, pRowUp, width, x0, x1, decodeScale, up, pNormals);
+	}
+
+	void FitIndicesAvx2(const int32_t* pTexels, const int32_t* pPalette, uint8_t* pIndices, uint32_t& squaredError, int32_t& maxError)
+	{
+		__m256i x[4][2];
+		for (size_t c = 0; c < 4; c++)
+		{
+			x[c][0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pTexels + c * 16));
+			x[c][1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pTexels + c * 16 + 8));
+		}
+
+		__m256i best[2] = { _mm256_set1_epi32(INT32_MAX), _mm256_set1_epi32(INT32_MAX) };
+		__m256i bestIndex[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+		for (int32_t i = 0; i < 16; i++)
+		{
+			const __m256i index = _mm256_set1_epi32(i);
+			for (size_t half = 0; half < 2; half++)
+			{
+				__m256i distance = _mm256_setzero_si256();
+				for (size_t c = 0; c < 4; c++)
+				{
+					const __m256i d = _mm256_sub_epi32(x[c][half], _mm256_set1_epi32(pPalette[c * 16 + i]));
+					distance = _mm256_add_epi32(distance, _mm256_mullo_epi32(d, d));
+				}
+
+				// strictly closer only, so ties keep the lower index like the scalar loop
+				const __m256i closer = _mm256_cmpgt_epi32(best[half], distance);
+				best[half] = _mm256_blendv_epi8(best[half], distance, closer);
+				bestIndex[half] = _mm256_blendv_epi8(bestIndex[half], index, closer);
+			}
+		}
+
+		// the decoded texels, looked up from the two halves of each palette channel
+		__m256i errors = _mm256_setzero_si256();
+		const __m256i seven = _mm256_set1_epi32(7);
+		for (size_t c = 0; c < 4; c++)
+		{
+			const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pPalette + c * 16));
+			const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pPalette + c * 16 + 8));
+			for (size_t half = 0; half < 2; half++)
+			{
+				const __m256i decoded = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(low, bestIndex[half]),
+					_mm256_permutevar8x32_epi32(high, bestIndex[half]), _mm256_cmpgt_epi32(bestIndex[half], seven));
+				errors = _mm256_max_epi32(errors, _mm256_abs_epi32(_mm256_sub_epi32(decoded, x[c][half])));
+			}
+		}
+
+		// horizontal max, then the indices narrowed to bytes and the distances summed
+		errors = _mm256_max_epi32(errors, _mm256_permute2x128_si256(errors, errors, 0x01));
+		errors = _mm256_max_epi32(errors, _mm256_shuffle_epi32(errors, _MM_SHUFFLE(1, 0, 3, 2)));
+		errors = _mm256_max_epi32(errors, _mm256_shuffle_epi32(errors, _MM_SHUFFLE(2, 3, 0, 1)));
+		maxError = _mm256_cvtsi256_si32(errors);
+
+		alignas(32) int32_t indices[16], distances[16];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(indices), bestIndex[0]);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(indices + 8), bestIndex[1]);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(distances), best[0]);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(distances + 8), best[1]);
+
+		squaredError = 0;
+		for (size_t t = 0; t < 16; t++)
+		{
+			pIndices[t] = static_cast<uint8_t>(indices[t]);
+			squaredError += distances[t];
+		}
+	}
+}
+#endif
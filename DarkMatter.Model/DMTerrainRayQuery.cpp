@@ -0,0 +1,313 @@
+#include "pch.h"
+#include "DMTerrainRayQuery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "DMPagedHeightMap.h"
+#include "DMParallel.h"
+
+namespace dm::model
+{
+	namespace
+	{
+		// the cell of the given size containing coordinate, clamped to the level
+		size_t CellIndex(float coordinate, float cellSize, size_t levelWidth)
+		{
+			const auto cell = std::floor(coordinate / cellSize);
+			return static_cast<size_t>(std::clamp(cell, 0.f, static_cast<float>(levelWidth - 1)));
+		}
+
+		// entry and exit of the ray through [min, max] along one axis, the whole line if it's parallel and inside
+		bool ClipSlab(float origin, float direction, float min, float max, float& tEnter, float& tExit)
+		{
+			if (direction == 0.f)
+				return origin >= min && origin <= max;
+
+			auto t0 = (min - origin) / direction;
+			auto t1 = (max - origin) / direction;
+			if (t0 > t1)
+				std::swap(t0, t1);
+
+			tEnter = std::max(tEnter, t0);
+			tExit = std::min(tExit, t1);
+			return tEnter <= tExit;
+		}
+	}
+
+	TerrainRayHit TerrainRayQuery::Intersect(const TerrainRay& ray)
+	{
+		Refresh();
+		return _pagedHeightMap != nullptr ? TracePaged(ray) : Trace(ray);
+	}
+
+	void TerrainRayQuery::Intersect(std::span<const TerrainRay> rays, std::span<TerrainRayHit> hits)
+	{
+		if (rays.size() != hits.size())
+			throw std::invalid_argument("TerrainRayQuery::Intersect: rays and hits must be the same length");
+
+		Refresh();
+		core::task::parallel_for({ .begin = 0, .end = rays.size() }, 16, [&](core::task::Range range)
+			{
+				for (size_t i = range.begin; i < range.end; i++)
+				{
+					hits[i] = _pagedHeightMap != nullptr ? TracePaged(rays[i]) : Trace(rays[i]);
+				}
+			});
+	}
+
+	void TerrainRayQuery::Refresh()
+	{
+		if (_pagedHeightMap != nullptr || !_heightMap->HasHeights())
+			return;
+
+		const auto generation = _heightMap->heightMapDirty.GetGeneration();
+		if (generation == _generation)
+			return;
+
+		_generation = generation;
+		_levels.clear();
+
+		const auto width = _heightMap->GetWidth();
+		if (width < 2)
+			return;
+
+		const auto cells = width - 1;
+
+		Level base{ .width = cells, .ranges = core::AlignedBuffer<HeightRange>::Uninitialized(cells * cells) };
+		core::task::parallel_for({ .begin = 0, .end = cells }, 16, [&](core::task::Range rows)
+			{
+				for (size_t z = rows.begin; z < rows.end; z++)
+				{
+					for (size_t x = 0; x < cells; x++)
+					{
+						const auto h00 = _heightMap->GetTexelHeight(x, z);
+						const auto h10 = _heightMap->GetTexelHeight(x + 1, z);
+						const auto h01 = _heightMap->GetTexelHeight(x, z + 1);
+						const auto h11 = _heightMap->GetTexelHeight(x + 1, z + 1);
+						base.ranges[z * cells + x] = { std::min({ h00, h10, h01, h11 }), std::max({ h00, h10, h01, h11 }) };
+					}
+				}
+			});
+		_levels.push_back(std::move(base));
+
+		while (_levels.back().width > 1)
+		{
+			const auto& below = _levels.back();
+			const auto levelWidth = (below.width + 1) / 2;
+			Level level{ .width = levelWidth, .ranges = core::AlignedBuffer<HeightRange>::Uninitialized(levelWidth * levelWidth) };
+
+			core::task::parallel_for({ .begin = 0, .end = levelWidth }, 16, [&](core::task::Range rows)
+				{
+					for (size_t z = rows.begin; z < rows.end; z++)
+					{
+						for (size_t x = 0; x < levelWidth; x++)
+						{
+							// edge nodes have fewer than four children
+							HeightRange range = below.ranges[(2 * z) * below.width + 2 * x];
+							for (size_t child = 1; child < 4; child++)
+							{
+								const auto childX = 2 * x + (child & 1);
+								const auto childZ = 2 * z + (child >> 1);
+								if (childX >= below.width || childZ >= below.width)
+									continue;
+
+								const auto& childRange = below.ranges[childZ * below.width + childX];
+								range.min = std::min(range.min, childRange.min);
+								range.max = std::max(range.max, childRange.max);
+							}
+							level.ranges[z * levelWidth + x] = range;
+						}
+					}
+				});
+			_levels.push_back(std::move(level));
+		}
+	}
+
+	TerrainRayHit TerrainRayQuery::Trace(const TerrainRay& ray) const
+	{
+		TerrainRayHit result;
+		if (_levels.empty())
+			return result;
+
+		// work in texel space horizontally, heights and t stay as they are so hits come out in the caller's units
+		const auto cells = static_cast<float>(_levels.front().width);
+		const auto texelsPerUnit = cells / _heightMap->GetWorldExtent();
+		const glm::vec3 origin(ray.origin.x * texelsPerUnit, ray.origin.y, ray.origin.z * texelsPerUnit);
+		const glm::vec3 direction(ray.direction.x * texelsPerUnit, ray.direction.y, ray.direction.z * texelsPerUnit);
+
+		const auto& top = _levels.back().ranges[0];
+		float t = 0.f;
+		float tExit = ray.tMax;
+		if (!ClipSlab(origin.x, direction.x, 0.f, cells, t, tExit) ||
+			!ClipSlab(origin.z, direction.z, 0.f, cells, t, tExit) ||
+			!ClipSlab(origin.y, direction.y, top.min, top.max, t, tExit))
+		{
+			return result;
+		}
+
+		// cells are looked up slightly ahead of t, so a t sitting on a cell border always moves on to the next cell
+		const auto horizontalSpeed = std::max(std::abs(direction.x), std::abs(direction.z));
+		const auto lookAhead = horizontalSpeed > 0.f ? 1e-3f / horizontalSpeed : 0.f;
+
+		size_t level = _levels.size() - 1;
+		while (t < tExit)
+		{
+			result.iterations++;
+
+			const auto& current = _levels[level];
+			const auto cellSize = static_cast<float>(size_t{ 1 } << level);
+			const auto lookup = origin + direction * (t + lookAhead);
+			const auto cellX = CellIndex(lookup.x, cellSize, current.width);
+			const auto cellZ = CellIndex(lookup.z, cellSize, current.width);
+
+			// where the ray leaves this node horizontally
+			float tCellExit = tExit;
+			float tUnused = t;
+			ClipSlab(origin.x, direction.x, cellX * cellSize, std::min((cellX + 1) * cellSize, cells), tUnused, tCellExit);
+			ClipSlab(origin.z, direction.z, cellZ * cellSize, std::min((cellZ + 1) * cellSize, cells), tUnused, tCellExit);
+			tCellExit = std::max(tCellExit, t);
+
+			// the ray is straight, its lowest point over the node is at one of the ends
+			const auto lowest = std::min(origin.y + direction.y * t, origin.y + direction.y * tCellExit);
+			if (lowest > current.ranges[cellZ * current.width + cellX].max)
+			{
+				t = tCellExit + lookAhead;
+				level = std::min(level + 1, _levels.size() - 1);
+				continue;
+			}
+
+			if (level > 0)
+			{
+				level--;
+				continue;
+			}
+
+			float tHit;
+			if (IntersectCell(_heightMap->GetTexelHeight(cellX, cellZ), _heightMap->GetTexelHeight(cellX + 1, cellZ), _heightMap->GetTexelHeight(cellX, cellZ + 1),
+				_heightMap->GetTexelHeight(cellX + 1, cellZ + 1), cellX, cellZ, origin, direction, t, tCellExit, tHit))
+			{
+				result.hit = true;
+				result.t = tHit;
+				result.position = ray.origin + ray.direction * tHit;
+				return result;
+			}
+
+			t = tCellExit + lookAhead;
+			level = std::min(level + 1, _levels.size() - 1);
+		}
+
+		return result;
+	}
+
+	TerrainRayHit TerrainRayQuery::TracePaged(const TerrainRay& ray) const
+	{
+		TerrainRayHit result;
+		const auto width = _pagedHeightMap->GetWidth();
+		if (width < 2)
+			return result;
+
+		// same texel space as Trace
+		const auto cells = static_cast<float>(width - 1);
+		const auto texelsPerUnit = cells / _pagedHeightMap->GetWorldExtent();
+		const glm::vec3 origin(ray.origin.x * texelsPerUnit, ray.origin.y, ray.origin.z * texelsPerUnit);
+		const glm::vec3 direction(ray.direction.x * texelsPerUnit, ray.direction.y, ray.direction.z * texelsPerUnit);
+
+		float t = 0.f;
+		float tExit = ray.tMax;
+		if (!ClipSlab(origin.x, direction.x, 0.f, cells, t, tExit) || !ClipSlab(origin.z, direction.z, 0.f, cells, t, tExit))
+			return result;
+
+		const auto horizontalSpeed = std::max(std::abs(direction.x), std::abs(direction.z));
+		const auto lookAhead = horizontalSpeed > 0.f ? 1e-3f / horizontalSpeed : 0.f;
+
+		while (t < tExit)
+		{
+			result.iterations++;
+
+			const auto lookup = origin + direction * (t + lookAhead);
+			const auto cellX = CellIndex(lookup.x, 1.f, width - 1);
+			const auto cellZ = CellIndex(lookup.z, 1.f, width - 1);
+
+			float tCellExit = tExit;
+			float tUnused = t;
+			ClipSlab(origin.x, direction.x, static_cast<float>(cellX), static_cast<float>(cellX + 1), tUnused, tCellExit);
+			ClipSlab(origin.z, direction.z, static_cast<float>(cellZ), static_cast<float>(cellZ + 1), tUnused, tCellExit);
+			tCellExit = std::max(tCellExit, t);
+
+			const auto h00 = _pagedHeightMap->TryGetTexelHeight(cellX, cellZ);
+			const auto h10 = _pagedHeightMap->TryGetTexelHeight(cellX + 1, cellZ);
+			const auto h01 = _pagedHeightMap->TryGetTexelHeight(cellX, cellZ + 1);
+			const auto h11 = _pagedHeightMap->TryGetTexelHeight(cellX + 1, cellZ + 1);
+			if (!h00 || !h10 || !h01 || !h11)
+				return result;
+
+			float tHit;
+			if (IntersectCell(*h00, *h10, *h01, *h11, cellX, cellZ, origin, direction, t, tCellExit, tHit))
+			{
+				result.hit = true;
+				result.t = tHit;
+				result.position = ray.origin + ray.direction * tHit;
+				return result;
+			}
+
+			t = tCellExit + lookAhead;
+		}
+
+		return result;
+	}
+
+	bool TerrainRayQuery::IntersectCell(double h00, double h10, double h01, double h11, size_t cellX, size_t cellZ, const glm::vec3& origin, const glm::vec3& direction,
+		float tStart, float tEnd, float& tHit)
+	{
+		// along the segment the bilinear surface is a quadratic in s = t - tStart, and so is the ray height above it:
+		// f(s) = a s^2 + b s + c, the hit is its first root in [0, sEnd]
+		const double u0 = origin.x + direction.x * tStart - static_cast<double>(cellX);
+		const double v0 = origin.z + direction.z * tStart - static_cast<double>(cellZ);
+		const double y0 = origin.y + direction.y * tStart;
+		const double du = direction.x;
+		const double dv = direction.z;
+		const double slopeU = h10 - h00;
+		const double slopeV = h01 - h00;
+		const double twist = h00 - h10 - h01 + h11;
+
+		const double a = -twist * du * dv;
+		const double b = direction.y - slopeU * du - slopeV * dv - twist * (u0 * dv + v0 * du);
+		const double c = y0 - (h00 + slopeU * u0 + slopeV * v0 + twist * u0 * v0);
+		const double sEnd = static_cast<double>(tEnd) - tStart;
+
+		if (c <= 0.0)
+		{
+			tHit = tStart;
+			return true;
+		}
+
+		double s = -1.0;
+		if (std::abs(a) < 1e-12 * std::max(std::abs(b), 1.0))
+		{
+			if (b < 0.0)
+				s = -c / b;
+		}
+		else
+		{
+			const double discriminant = b * b - 4.0 * a * c;
+			if (discriminant < 0.0)
+				return false;
+
+			// the numerically stable pair of roots
+			const double q = -0.5 * (b + std::copysign(std::sqrt(discriminant), b));
+			const double r0 = q / a;
+			const double r1 = q != 0.0 ? c / q : r0;
+			const double first = std::min(r0, r1);
+			const double second = std::max(r0, r1);
+			s = first >= 0.0 ? first : second;
+		}
+
+		if (s < 0.0 || s > sEnd)
+			return false;
+
+		tHit = static_cast<float>(tStart + s);
+		return true;
+	}
+}
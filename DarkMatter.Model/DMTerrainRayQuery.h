@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "DMAlignedBuffer.h"
+#include "DMHeightMap.h"
+
+namespace dm::model
+{
+	class PagedHeightMap;
+
+	struct TerrainRay
+	{
+		glm::vec3 origin;
+		// doesn't need to be normalized, hit distances are in multiples of it
+		glm::vec3 direction;
+		float tMax = std::numeric_limits<float>::max();
+	};
+
+	struct TerrainRayHit
+	{
+		bool hit = false;
+		float t = 0.f;
+		glm::vec3 position{};
+		// pyramid nodes and texel cells visited, for profiling
+		uint32_t iterations = 0;
+	};
+
+	// Ray queries against the heights of a TerrainHeightMap. Reads the live map, the only thing it owns is a min/max
+	// pyramid over the texel cells, rebuilt when the height dirty map says the heights changed. A ray skips every
+	// pyramid node it passes above and is only tested exactly against the bilinear surface of the cells it can hit.
+	// A paged map has no pyramid, rays walk its texel cells one by one and stop at the first one that isn't resident,
+	// nothing past it is known.
+	// Not thread safe against writers of the map, same as the map itself.
+	class TerrainRayQuery
+	{
+	public:
+		explicit TerrainRayQuery(const TerrainHeightMap& heightMap) : _heightMap(&heightMap) {}
+		explicit TerrainRayQuery(const PagedHeightMap& heightMap) : _pagedHeightMap(&heightMap) {}
+
+		// first point where the ray goes below the terrain, rays that miss the map area never hit
+		TerrainRayHit Intersect(const TerrainRay& ray);
+		// one hit per ray, spread over the task system when there are enough of them
+		void Intersect(std::span<const TerrainRay> rays, std::span<TerrainRayHit> hits);
+
+		// whichever of the two the query was made for, the other one is nullptr
+		const TerrainHeightMap* GetHeightMap() const { return _heightMap; }
+		const PagedHeightMap* GetPagedHeightMap() const { return _pagedHeightMap; }
+
+	private:
+		struct HeightRange
+		{
+			float min;
+			float max;
+		};
+
+		struct Level
+		{
+			size_t width;
+			core::AlignedBuffer<HeightRange> ranges;
+		};
+
+		void Refresh();
+		TerrainRayHit Trace(const TerrainRay& ray) const;
+		TerrainRayHit TracePaged(const TerrainRay& ray) const;
+		// h00..h11 are the heights at the cell's corners, x first
+		static bool IntersectCell(double h00, double h10, double h01, double h11, size_t cellX, size_t cellZ, const glm::vec3& origin, const glm::vec3& direction,
+			float tStart, float tEnd, float& tHit);
+
+		const TerrainHeightMap* _heightMap = nullptr;
+		const PagedHeightMap* _pagedHeightMap = nullptr;
+		// level 0 has one range per texel cell (the quad between four texels), each level above halves both sides
+		std::vector<Level> _levels;
+		uint64_t _generation = 0;
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace dm::model
+{
+	// One bit per square tile of a width * width layer. Writers mark the texels they touched, whoever publishes the layer
+	// only looks at the marked tiles and clears the map afterwards.
+	class TileDirtyMap
+	{
+	public:
+		static constexpr size_t tileSize = 64;
+
+		TileDirtyMap() = default;
+		explicit TileDirtyMap(size_t width, bool dirty = true)
+			: _tilesPerRow((width + tileSize - 1) / tileSize), _bits((_tilesPerRow * _tilesPerRow + 63) / 64)
+		{
+			if (dirty)
+				MarkAll();
+		}
+
+		// marks every tile overlapping [x, x + w) * [z, z + h), the region is clamped to the layer
+		void MarkRegion(size_t x, size_t z, size_t w, size_t h)
+		{
+			if (w == 0 || h == 0)
+				return;
+
+			const auto lastX = std::min((x + w - 1) / tileSize, _tilesPerRow - 1);
+			const auto lastZ = std::min((z + h - 1) / tileSize, _tilesPerRow - 1);
+			for (size_t tileZ = z / tileSize; tileZ <= lastZ; tileZ++)
+			{
+				for (size_t tileX = x / tileSize; tileX <= lastX; tileX++)
+				{
+					const auto tile = tileZ * _tilesPerRow + tileX;
+					_bits[tile / 64] |= uint64_t{ 1 } << (tile % 64);
+				}
+			}
+			_generation = ++_generationCounter;
+		}
+
+		void MarkAll()
+		{
+			std::fill(_bits.begin(), _bits.end(), ~uint64_t{ 0 });
+			_generation = ++_generationCounter;
+		}
+
+		void Clear()
+		{
+			std::fill(_bits.begin(), _bits.end(), 0);
+		}
+
+		[[nodiscard]] bool IsDirty(size_t tile) const { return (_bits[tile / 64] >> (tile % 64)) & 1; }
+		[[nodiscard]] bool Any() const { return std::ranges::any_of(_bits, [](uint64_t word) { return word != 0; }); }
+
+		[[nodiscard]] size_t GetTilesPerRow() const { return _tilesPerRow; }
+
+		// changes on every mark and survives Clear, for caches derived from the layer that aren't the snapshot.
+		// it's unique across maps, so a layer that was replaced wholesale never looks unchanged
+		[[nodiscard]] uint64_t GetGeneration() const { return _generation; }
+
+	private:
+		inline static std::atomic<uint64_t> _generationCounter = 0;
+
+		size_t _tilesPerRow = 0;
+		std::vector<uint64_t> _bits;
+		uint64_t _generation = 0;
+	};
+}
@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "DMTiledLayer.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "DMGraphicsPrimitives.h"
+
+namespace dm::model
+{
+	template <typename T>
+	TiledLayer<T>::TiledLayer(size_t width, const T& value)
+		: _width(width), _tilesPerRow((width + tileSize - 1) / tileSize), _default(value), _tiles(_tilesPerRow * _tilesPerRow)
+	{
+		// every value is the same, so tiles with the same texel count can share whatever their shape
+		for (size_t t = 0; t < _tiles.size(); t++)
+		{
+			const auto texels = TileWidth(t % _tilesPerRow) * TileWidth(t / _tilesPerRow);
+			if (std::ranges::none_of(_defaults, [texels](const auto& pTile) { return pTile->size() == texels; }))
+				_defaults.push_back(std::make_shared<Tile>(texels, value));
+
+			_tiles[t] = DefaultTile(texels);
+		}
+	}
+
+	template <typename T>
+	size_t TiledLayer<T>::GetMaterializedTiles() const
+	{
+		size_t count = 0;
+		for (size_t t = 0; t < _tiles.size(); t++)
+		{
+			count += IsDefault(t) ? 0 : 1;
+		}
+		return count;
+	}
+
+	template <typename T>
+	void TiledLayer<T>::Fill(size_t x, size_t z, size_t w, size_t h, const T& value)
+	{
+		x = std::min(x, _width);
+		z = std::min(z, _width);
+		w = std::min(w, _width - x);
+		h = std::min(h, _width - z);
+		if (w == 0 || h == 0)
+			return;
+
+		for (size_t tileZ = z / tileSize; tileZ <= (z + h - 1) / tileSize; tileZ++)
+		{
+			for (size_t tileX = x / tileSize; tileX <= (x + w - 1) / tileSize; tileX++)
+			{
+				// the part of the region inside this tile, in tile texels
+				const auto x0 = std::max(x, tileX * tileSize) - tileX * tileSize;
+				const auto z0 = std::max(z, tileZ * tileSize) - tileZ * tileSize;
+				const auto x1 = std::min(x + w, (tileX + 1) * tileSize) - tileX * tileSize;
+				const auto z1 = std::min(z + h, (tileZ + 1) * tileSize) - tileZ * tileSize;
+				const auto columns = TileWidth(tileX);
+				const auto rows = TileWidth(tileZ);
+				const auto t = tileZ * _tilesPerRow + tileX;
+
+				// a tile that's overwritten whole goes back to the default if that's what it's filled with, a shared one is
+				// replaced instead of cloned and then overwritten
+				if (x0 == 0 && z0 == 0 && x1 == columns && z1 == rows)
+				{
+					if (memcmp(&value, &_default, sizeof(T)) == 0)
+					{
+						Reset(t);
+						continue;
+					}
+
+					if (_tiles[t].use_count() > 1)
+					{
+						_tiles[t] = std::make_shared<Tile>(columns * rows, value);
+						continue;
+					}
+				}
+
+				auto& tile = MutableTile(t);
+				for (size_t row = z0; row < z1; row++)
+				{
+					std::fill(tile.begin() + row * columns + x0, tile.begin() + row * columns + x1, value);
+				}
+			}
+		}
+	}
+
+	template class TiledLayer<DMR8G8B8A8Pixel>;
+}
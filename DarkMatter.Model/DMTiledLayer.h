@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "DMTileDirtyMap.h"
+
+namespace dm::model
+{
+	// A width * width layer kept as square tiles that copies of the layer share. Copying the layer only copies the tile
+	// pointers, a write clones the tile it lands in first if anything else still holds that tile. Snapshots of a layer
+	// cost nothing when they're taken and afterwards only the tiles written since.
+	// Tiles nobody wrote all point at one shared tile of the default value, so a new layer allocates next to nothing and
+	// memory grows with the area written.
+	// Writes and copies are for the owning thread. Other threads can hold and drop copies whenever they like, at worst a
+	// tile that was just let go is cloned once more than it had to be, a shared tile is never written.
+	template <typename T>
+	class TiledLayer
+	{
+	public:
+		static constexpr size_t tileSize = TileDirtyMap::tileSize;
+		// rows packed back to back, edge tiles are cut short when width isn't a multiple of tileSize
+		using Tile = std::vector<T>;
+
+		TiledLayer() = default;
+		// every tile reads as value until it's written
+		TiledLayer(size_t width, const T& value);
+
+		[[nodiscard]] size_t GetWidth() const { return _width; }
+		[[nodiscard]] size_t GetTilesPerRow() const { return _tilesPerRow; }
+		[[nodiscard]] size_t TileWidth(size_t tileX) const { return std::min(tileSize, _width - tileX * tileSize); }
+
+		[[nodiscard]] const Tile& GetTile(size_t tile) const { return *_tiles[tile]; }
+		// for snapshots, the tile stays shared until the next write to it
+		[[nodiscard]] std::shared_ptr<const Tile> ShareTile(size_t tile) const { return _tiles[tile]; }
+
+		[[nodiscard]] const T& GetDefault() const { return _default; }
+		// true while the tile is still the shared default one
+		[[nodiscard]] bool IsDefault(size_t tile) const { return _tiles[tile] == DefaultTile(_tiles[tile]->size()); }
+		// tiles that have storage of their own
+		[[nodiscard]] size_t GetMaterializedTiles() const;
+		// points the tile back at the shared default, for a tile that was written with nothing but the default
+		void Reset(size_t tile) { _tiles[tile] = DefaultTile(_tiles[tile]->size()); }
+		// replaces the tile with one built elsewhere, e.g. decoded on a worker. it has to have the tile's texel count
+		void SetTile(size_t tile, std::shared_ptr<Tile> pTile)
+		{
+			if (pTile == nullptr || pTile->size() != _tiles[tile]->size())
+				throw std::invalid_argument("TiledLayer::SetTile: the tile has the wrong number of texels");
+
+			_tiles[tile] = std::move(pTile);
+		}
+
+		// clones the tile first if it's shared, the shared default always is
+		Tile& MutableTile(size_t tile)
+		{
+			auto& pTile = _tiles[tile];
+			if (pTile.use_count() > 1)
+				pTile = std::make_shared<Tile>(*pTile);
+
+			return *pTile;
+		}
+
+		[[nodiscard]] const T& At(size_t x, size_t z) const
+		{
+			return GetTile((z / tileSize) * _tilesPerRow + x / tileSize)[(z % tileSize) * TileWidth(x / tileSize) + x % tileSize];
+		}
+
+		void Set(size_t x, size_t z, const T& value)
+		{
+			MutableTile((z / tileSize) * _tilesPerRow + x / tileSize)[(z % tileSize) * TileWidth(x / tileSize) + x % tileSize] = value;
+		}
+
+		// fills [x, x + w) * [z, z + h), the region is clamped to the layer
+		void Fill(size_t x, size_t z, size_t w, size_t h, const T& value);
+
+	private:
+		// the default tile with that many texels. the layer holds on to every one, so they're never written in place
+		const std::shared_ptr<Tile>& DefaultTile(size_t texels) const
+		{
+			return *std::ranges::find_if(_defaults, [texels](const auto& pTile) { return pTile->size() == texels; });
+		}
+
+		size_t _width = 0;
+		size_t _tilesPerRow = 0;
+		T _default{};
+		// one per tile size, at most full tiles, edge tiles and the corner tile
+		std::vector<std::shared_ptr<Tile>> _defaults;
+		std::vector<std::shared_ptr<Tile>> _tiles;
+	};
+}
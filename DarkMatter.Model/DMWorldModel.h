@@ -1,20 +1,35 @@
 #pragma once
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "DMCell.h"
 #include "DMAssetRegistry.h"
 #include "DMHeightMap.h"
+#include "DMPagedHeightMap.h"
 
 namespace dm::model
 {
 	class WorldModel
 	{
 	public:
+		// without heights of its own while pagedHeightMap is set, overlay and splat are always here
 		TerrainHeightMap terrainHeightMap = TerrainHeightMap(0, 0);
+		// only for terrain files too big to load whole, the heights are streamed around the active camera
+		std::unique_ptr<PagedHeightMap> pagedHeightMap;
 		core::AssetRegistry assetRegistry;
 		std::vector<Cell> cellRegistry;
 		std::vector<Cell> cellStore;
 		std::vector<std::shared_ptr<core::GameObject>> globalObjectStore;
 		size_t activeCamera;
+
+		// height at world x/z from whichever map has the heights. nullopt where the pages aren't resident
+		std::optional<float> GetTerrainHeight(float x, float z) const
+		{
+			if (pagedHeightMap != nullptr)
+				return pagedHeightMap->TryGetHeight(x, z);
+
+			return terrainHeightMap.GetHeight(x, z);
+		}
 	};
 }
@@ -0,0 +1,307 @@
+#include "pch.h"
+#include "DMWorldSnapshot.h"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+
+#include "DMCamera.h"
+#include "DMParallel.h"
+#include "DMWorldModel.h"
+
+namespace dm::model
+{
+	template <typename T, size_t TileSize>
+	void TerrainLayerSnapshot<T, TileSize>::CopyTo(T* pDst) const
+	{
+		core::task::parallel_for({ .begin = 0, .end = tilesPerRow }, 1, [&](core::task::Range tileRows)
+			{
+				for (size_t tileZ = tileRows.begin; tileZ < tileRows.end; tileZ++)
+				{
+					const auto rows = TileWidth(tileZ);
+					for (size_t tileX = 0; tileX < tilesPerRow; tileX++)
+					{
+						const auto& tile = *tiles[tileZ * tilesPerRow + tileX];
+						const auto columns = TileWidth(tileX);
+						for (size_t row = 0; row < rows; row++)
+						{
+							memcpy(&pDst[(tileZ * tileSize + row) * width + tileX * tileSize], &tile[row * columns], columns * sizeof(T));
+						}
+					}
+				}
+			});
+	}
+
+	template struct TerrainLayerSnapshot<float>;
+	template struct TerrainLayerSnapshot<uint16_t>;
+	template struct TerrainLayerSnapshot<PackedNormal>;
+	template struct TerrainLayerSnapshot<DMR8G8B8A8Pixel>;
+	template struct TerrainLayerSnapshot<SplatBlock, splatBlockTileSize>;
+
+	namespace
+	{
+		template <typename T>
+		TerrainLayerSnapshot<T> BuildLayer(core::GridView<const T> rows, const TerrainLayerSnapshot<T>* previous, TileDirtyMap& dirty)
+		{
+			const auto width = rows.width;
+			constexpr auto tileSize = TerrainLayerSnapshot<T>::tileSize;
+
+			if (previous != nullptr && previous->width == width && !dirty.Any())
+				return *previous;
+
+			TerrainLayerSnapshot<T> layer;
+			layer.width = width;
+			layer.tilesPerRow = (width + tileSize - 1) / tileSize;
+			layer.tiles.resize(layer.tilesPerRow * layer.tilesPerRow);
+
+			const bool comparable = previous != nullptr && previous->width == width;
+			std::atomic<bool> changed = !comparable;
+
+			core::task::parallel_for({ .begin = 0, .end = layer.tiles.size() }, 4, [&](core::task::Range tileRange)
+				{
+					for (size_t t = tileRange.begin; t < tileRange.end; t++)
+					{
+						const auto tileX = t % layer.tilesPerRow;
+						const auto tileZ = t / layer.tilesPerRow;
+						const auto columns = layer.TileWidth(tileX);
+						const auto tileRows = layer.TileWidth(tileZ);
+
+						if (comparable && !dirty.IsDirty(t))
+						{
+							layer.tiles[t] = previous->tiles[t];
+							continue;
+						}
+
+						// a marked tile can still match, e.g. a brush that painted the same values again
+						if (comparable)
+						{
+							const auto& old = *previous->tiles[t];
+							bool same = true;
+							for (size_t row = 0; row < tileRows && same; row++)
+							{
+								same = memcmp(&old[row * columns], &rows(tileX * tileSize, tileZ * tileSize + row), columns * sizeof(T)) == 0;
+							}
+
+							if (same)
+							{
+								layer.tiles[t] = previous->tiles[t];
+								continue;
+							}
+						}
+
+						auto tile = std::make_shared<std::vector<T>>(columns * tileRows);
+						for (size_t row = 0; row < tileRows; row++)
+						{
+							memcpy(&(*tile)[row * columns], &rows(tileX * tileSize, tileZ * tileSize + row), columns * sizeof(T));
+						}
+
+						layer.tiles[t] = std::move(tile);
+						changed = true;
+					}
+				});
+
+			dirty.Clear();
+			layer.revision = (previous != nullptr ? previous->revision : 0) + (changed ? 1 : 0);
+			return layer;
+		}
+
+		// the live layer is already tiles, shareTile(t) hands out each of them. a tile that changed since previous is a
+		// new tile, so a different pointer is exactly a changed tile
+		template <typename T, typename ShareTile>
+		TerrainLayerSnapshot<T> ShareTiles(size_t width, size_t tilesPerRow, const ShareTile& shareTile, const TerrainLayerSnapshot<T>* previous)
+		{
+			TerrainLayerSnapshot<T> layer;
+			layer.width = width;
+			layer.tilesPerRow = tilesPerRow;
+			layer.tiles.resize(layer.tilesPerRow * layer.tilesPerRow);
+
+			bool changed = previous == nullptr || previous->width != layer.width;
+			for (size_t t = 0; t < layer.tiles.size(); t++)
+			{
+				layer.tiles[t] = shareTile(t);
+				changed = changed || layer.tiles[t] != previous->tiles[t];
+			}
+
+			layer.revision = (previous != nullptr ? previous->revision : 0) + (changed ? 1 : 0);
+			return layer;
+		}
+
+		// a tile the map wrote since previous was cloned on the way
+		template <typename T>
+		TerrainLayerSnapshot<T> ShareLayer(const TiledLayer<T>& live, const TerrainLayerSnapshot<T>* previous)
+		{
+			return ShareTiles<T>(live.GetWidth(), live.GetTilesPerRow(), [&live](size_t t) { return live.ShareTile(t); }, previous);
+		}
+
+		// encodes the splat tiles that aren't the ones previous encoded. unpainted tiles all share the default tile, that
+		// one's encoded once and its blocks shared the same way
+		TerrainLayerSnapshot<SplatBlock, splatBlockTileSize> EncodeSplat(const TerrainLayerSnapshot<DMR8G8B8A8Pixel>& splat,
+			const WorldSnapshot* previous, SplatEncodeStats& stats)
+		{
+			constexpr auto blockWidth = SplatBlock::blockWidth;
+			TerrainLayerSnapshot<SplatBlock, splatBlockTileSize> layer;
+			if (splat.width == 0 || splat.width % blockWidth != 0)
+				return layer;
+
+			const auto start = std::chrono::steady_clock::now();
+			layer.width = splat.width / blockWidth;
+			layer.tilesPerRow = splat.tilesPerRow;
+			layer.tiles.resize(layer.tilesPerRow * layer.tilesPerRow);
+
+			const bool comparable = previous != nullptr && previous->splat.width == splat.width && previous->splatBlocks.width == layer.width;
+
+			// source tile to the destination tiles that hold it
+			std::unordered_map<const std::vector<DMR8G8B8A8Pixel>*, std::vector<size_t>> pending;
+			for (size_t t = 0; t < layer.tiles.size(); t++)
+			{
+				if (comparable && splat.tiles[t] == previous->splat.tiles[t])
+				{
+					layer.tiles[t] = previous->splatBlocks.tiles[t];
+					continue;
+				}
+
+				pending[splat.tiles[t].get()].push_back(t);
+			}
+
+			if (pending.empty())
+			{
+				layer.revision = previous->splatBlocks.revision;
+				return layer;
+			}
+
+			std::vector<const std::vector<size_t>*> work;
+			work.reserve(pending.size());
+			for (const auto& [pTile, targets] : pending)
+			{
+				work.push_back(&targets);
+			}
+
+			std::vector<uint8_t> errors(work.size());
+			std::mutex errorMutex;
+			std::exception_ptr error;
+			core::task::parallel_for({ .begin = 0, .end = work.size() }, 1, [&](core::task::Range range)
+				{
+					try
+					{
+						for (size_t i = range.begin; i < range.end; i++)
+						{
+							const auto t = work[i]->front();
+							const auto columns = splat.TileWidth(t % splat.tilesPerRow);
+							const auto rows = splat.TileWidth(t / splat.tilesPerRow);
+							auto blocks = std::make_shared<std::vector<SplatBlock>>((columns / blockWidth) * (rows / blockWidth));
+							errors[i] = EncodeSplatTile(*splat.tiles[t], columns, rows, *blocks);
+							for (const auto target : *work[i])
+							{
+								layer.tiles[target] = blocks;
+							}
+						}
+					}
+					catch (...)
+					{
+						std::lock_guard lock(errorMutex);
+						if (error == nullptr)
+							error = std::current_exception();
+					}
+				});
+
+			if (error != nullptr)
+				std::rethrow_exception(error);
+
+			stats.tilesEncoded = work.size();
+			for (const auto tileError : errors)
+			{
+				stats.maxError = std::max(stats.maxError, tileError);
+				stats.tilesOverTolerance += tileError > defaultSplatTolerance ? 1 : 0;
+			}
+			stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			layer.revision = (previous != nullptr ? previous->splatBlocks.revision : 0) + 1;
+			return layer;
+		}
+
+		bool SameCell(Cell& live, const Cell& published)
+		{
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				if (live.GetTerrainTexture(i) != published.GetTerrainTexture(i))
+					return false;
+			}
+
+			return live.GetName() == published.GetName();
+		}
+	}
+
+	std::shared_ptr<const WorldSnapshot> BuildSnapshot(WorldModel& world, const std::shared_ptr<const WorldSnapshot>& previous)
+	{
+		auto snapshot = std::make_shared<WorldSnapshot>();
+		snapshot->version = previous != nullptr ? previous->version + 1 : 1;
+
+		// cells are only copied when they differ from the published one
+		snapshot->cells.reserve(world.cellStore.size());
+		for (size_t i = 0; i < world.cellStore.size(); i++)
+		{
+			auto& cell = world.cellStore[i];
+			if (previous != nullptr && i < previous->cells.size() && SameCell(cell, *previous->cells[i]))
+			{
+				snapshot->cells.push_back(previous->cells[i]);
+			}
+			else
+			{
+				snapshot->cells.push_back(std::make_shared<const Cell>(cell));
+			}
+		}
+
+		auto& terrain = world.terrainHeightMap;
+		if (const auto* pPaged = world.pagedHeightMap.get(); pPaged != nullptr)
+		{
+			// pages are the snapshot's tiles, this version has whatever is resident and flat ground for the rest
+			const auto width = pPaged->GetWidth();
+			const auto tilesPerRow = pPaged->GetPagesPerRow();
+			if (pPaged->GetHeightStorage() == HeightStorage::Float32)
+			{
+				snapshot->heights = ShareTiles<float>(width, tilesPerRow, [pPaged](size_t t) { return pPaged->ShareHeightTile(t); },
+					previous != nullptr ? &previous->heights : nullptr);
+			}
+			else
+			{
+				snapshot->quantizedHeights = ShareTiles<uint16_t>(width, tilesPerRow, [pPaged](size_t t) { return pPaged->ShareQuantizedHeightTile(t); },
+					previous != nullptr ? &previous->quantizedHeights : nullptr);
+				snapshot->heightScale = pPaged->GetHeightScale();
+				snapshot->heightOffset = pPaged->GetHeightOffset();
+			}
+			snapshot->normals = ShareTiles<PackedNormal>(width, tilesPerRow, [pPaged](size_t t) { return pPaged->ShareNormalTile(t); },
+				previous != nullptr ? &previous->normals : nullptr);
+		}
+		else
+		{
+			if (terrain.GetHeightStorage() == HeightStorage::Float32)
+			{
+				snapshot->heights = BuildLayer<float>(terrain.GetHeights(), previous != nullptr ? &previous->heights : nullptr, terrain.heightMapDirty);
+			}
+			else
+			{
+				snapshot->quantizedHeights = BuildLayer<uint16_t>(terrain.GetQuantizedHeights(), previous != nullptr ? &previous->quantizedHeights : nullptr, terrain.heightMapDirty);
+				snapshot->heightScale = terrain.GetHeightScale();
+				snapshot->heightOffset = terrain.GetHeightOffset();
+			}
+			// normals follow whatever heights this version has
+			terrain.UpdateNormals();
+			snapshot->normals = BuildLayer<PackedNormal>(terrain.GetNormals(), previous != nullptr ? &previous->normals : nullptr, terrain.normalMapDirty);
+		}
+		snapshot->overlay = ShareLayer(terrain.GetOverlay(), previous != nullptr ? &previous->overlay : nullptr);
+		snapshot->splat = ShareLayer(terrain.GetSplat(), previous != nullptr ? &previous->splat : nullptr);
+		snapshot->splatBlocks = EncodeSplat(snapshot->splat, previous.get(), snapshot->splatEncodeStats);
+
+		if (world.activeCamera < world.globalObjectStore.size())
+		{
+			if (auto camera = std::dynamic_pointer_cast<core::Camera>(world.globalObjectStore[world.activeCamera]))
+			{
+				snapshot->camera = CameraSnapshot{ .view = camera->GetViewMatrix(), .projection = camera->GetProjectionMatrix(), .position = camera->position };
+			}
+		}
+
+		return snapshot;
+	}
+}
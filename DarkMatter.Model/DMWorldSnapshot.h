@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "DMCell.h"
+#include "DMGraphicsPrimitives.h"
+#include "DMHeightMap.h"
+#include "DMSplatCompression.h"
+#include "DMTileDirtyMap.h"
+
+namespace dm::model
+{
+	class WorldModel;
+
+	// One terrain layer (heights, overlay, splat) cut into square tiles. Snapshots share the tiles that didn't change
+	// between versions, so publishing a small edit only copies the tiles it touched.
+	// A layer of compressed blocks has TileSize blocks to a side, so its tiles still cover the same texels.
+	template <typename T, size_t TileSize = TileDirtyMap::tileSize>
+	struct TerrainLayerSnapshot
+	{
+		static constexpr size_t tileSize = TileSize;
+
+		size_t width = 0;
+		size_t tilesPerRow = 0;
+		// bumped whenever any tile is replaced, consumers compare it to what they last uploaded
+		uint64_t revision = 0;
+		// row major, edge tiles are cut short when width isn't a multiple of tileSize
+		std::vector<std::shared_ptr<const std::vector<T>>> tiles;
+
+		[[nodiscard]] size_t TileWidth(size_t tileX) const { return std::min(tileSize, width - tileX * tileSize); }
+
+		[[nodiscard]] const T& At(size_t x, size_t z) const
+		{
+			const auto& tile = *tiles[(z / tileSize) * tilesPerRow + x / tileSize];
+			return tile[(z % tileSize) * TileWidth(x / tileSize) + x % tileSize];
+		}
+
+		// writes the layer out as width * width row major values
+		void CopyTo(T* pDst) const;
+	};
+
+	// the splat tiles this version had to encode, the rest were carried over from the previous one
+	struct SplatEncodeStats
+	{
+		size_t tilesEncoded = 0;
+		// worst per channel difference between the encoded tiles and the splat, in 8 bit steps
+		uint8_t maxError = 0;
+		size_t tilesOverTolerance = 0;
+		double milliseconds = 0.0;
+	};
+
+	struct CameraSnapshot
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+	};
+
+	// Immutable view of the world at one version, safe to read from any thread while the next version is being built.
+	struct WorldSnapshot
+	{
+		uint64_t version = 0;
+		std::vector<std::shared_ptr<const Cell>> cells;
+		// exactly one of the two height layers is filled, depending on the map's HeightStorage
+		TerrainLayerSnapshot<float> heights;
+		TerrainLayerSnapshot<uint16_t> quantizedHeights;
+		// decode for quantizedHeights: value / 65535 * heightScale + heightOffset
+		float heightScale = 1.f;
+		float heightOffset = 0.f;
+		TerrainLayerSnapshot<PackedNormal> normals;
+		TerrainLayerSnapshot<DMR8G8B8A8Pixel> overlay;
+		TerrainLayerSnapshot<DMR8G8B8A8Pixel> splat;
+		// splat as BC7 blocks, a quarter of the size to upload and keep resident. empty if the splat width isn't a
+		// multiple of the block width, the renderer uses splat as is then
+		TerrainLayerSnapshot<SplatBlock, splatBlockTileSize> splatBlocks;
+		SplatEncodeStats splatEncodeStats;
+		CameraSnapshot camera;
+	};
+
+	// Builds the version after previous from the live world, sharing every cell and terrain tile that hasn't changed.
+	// Consumes the height and normal dirty maps, only marked tiles are compared and copied. Overlay and splat tiles are
+	// shared with the live map, which clones them before writing. Only splat tiles that changed are encoded again.
+	std::shared_ptr<const WorldSnapshot> BuildSnapshot(WorldModel& world, const std::shared_ptr<const WorldSnapshot>& previous);
+
+	// Latest published snapshot. The writer publishes a new version while readers keep whichever one they acquired alive,
+	// so there's no lock between building a version and rendering the last one.
+	class WorldSnapshotChannel
+	{
+	public:
+		void Publish(std::shared_ptr<const WorldSnapshot> snapshot) { _latest.store(std::move(snapshot)); }
+		[[nodiscard]] std::shared_ptr<const WorldSnapshot> Acquire() const { return _latest.load(); }
+
+	private:
+		std::atomic<std::shared_ptr<const WorldSnapshot>> _latest;
+	};
+}
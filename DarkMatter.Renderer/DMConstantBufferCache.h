@@ -58,7 +58,7 @@ namespace dm::renderer
 						std::shared_ptr<dm3d::Buffer> popped;
 						_freeList.try_dequeue(popped);
 					}
-				}, std::make_shared<core::task::SyncCounter>());
+				}, core::task::Priority::Background);
 			}
 		}
 
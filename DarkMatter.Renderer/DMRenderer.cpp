@@ -61,12 +61,12 @@ namespace dm::renderer
 		_context->register_depth_stencil_view(_depthBuffer);
 	}
 
-	void Renderer::RenderWorld()
+	void Renderer::RenderWorld(const model::WorldSnapshot& snapshot)
 	{
 		assert(_worldModel != nullptr);
 
-		RenderSky(_worldModel);
-		RenderTerrain(_worldModel);
+		RenderSky(snapshot);
+		RenderTerrain(snapshot);
 	}
 
 	void Renderer::Present()
@@ -6,6 +6,7 @@
 #include "DMLogger.h"
 #include "DMShaderCache.h"
 #include "DMWorldModel.h"
+#include "DMWorldSnapshot.h"
 #include "SharedShaderTypes.h"
 
 class dm3d::Context;
@@ -25,7 +26,7 @@ namespace dm::renderer
 		~Renderer();
 
 		void SetWorld(model::WorldModel* pWorldModel, core::FileSystem* pFileSystem);
-		void RenderWorld();
+		void RenderWorld(const model::WorldSnapshot& snapshot);
 		void RebuildSwapchain(uint32_t width, uint32_t height);
 
 		void Present();
@@ -41,11 +42,13 @@ namespace dm::renderer
 	private:
 		void InitTerrainResources();
 
-		void RenderTerrain(model::WorldModel* pWorld);
-		void RenderSky(model::WorldModel* pWorld);
-		void RebuildHeightmap(model::TerrainHeightMap* pHeightMap);
-		void RebuildHeightmapOverlay(model::TerrainHeightMap* pHeightMap);
-		void RebuildCellSplatMap(model::TerrainHeightMap* pHeightMap);
+		void RenderTerrain(const model::WorldSnapshot& snapshot);
+		void RenderSky(const model::WorldSnapshot& snapshot);
+		// brings image up to date with layer, returns the number of tiles uploaded. a layer of blocks fills an image
+		// blockWidth times its width
+		template <typename T, size_t TileSize>
+		size_t UpdateTerrainLayer(const model::TerrainLayerSnapshot<T, TileSize>& layer, model::TerrainLayerSnapshot<T, TileSize>& uploaded,
+			std::shared_ptr<dm3d::Image>& image, dm3d::ImageFormat format, const char* name);
 
 		std::optional<SplatPack> GetSplatPack(const model::Cell& pCell) const;
 
@@ -56,8 +59,19 @@ namespace dm::renderer
 
 		std::shared_ptr<dm3d::Image> _depthBuffer;
 		std::shared_ptr<dm3d::Image> _heightMap;
+		std::shared_ptr<dm3d::Image> _terrainNormalMap;
 		std::shared_ptr<dm3d::Image> _heightMapOverlay;
 		std::shared_ptr<dm3d::Image> _heightMapSplat;
+		// layers as they are on the GPU, a tile whose pointer differs from the new snapshot's has to be uploaded again
+		model::TerrainLayerSnapshot<float> _uploadedHeights;
+		model::TerrainLayerSnapshot<uint16_t> _uploadedQuantizedHeights;
+		model::TerrainLayerSnapshot<model::PackedNormal> _uploadedNormals;
+		model::TerrainLayerSnapshot<DMR8G8B8A8Pixel> _uploadedOverlay;
+		// the splat is uploaded from exactly one of these, blocks whenever the snapshot has them
+		model::TerrainLayerSnapshot<DMR8G8B8A8Pixel> _uploadedSplat;
+		model::TerrainLayerSnapshot<model::SplatBlock, model::splatBlockTileSize> _uploadedSplatBlocks;
+		model::SplatEncodeStats _splatEncodeStats;
+		size_t _tilesUploaded = 0;
 
 		// terrain
 		std::unique_ptr<ConstantBufferCache<TerrainCellDrawData>> _terrainDrawDataCache;
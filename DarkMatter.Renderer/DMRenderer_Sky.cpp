@@ -3,7 +3,7 @@
 
 namespace dm::renderer
 {
-	void Renderer::RenderSky(model::WorldModel* pWorld)
+	void Renderer::RenderSky(const model::WorldSnapshot& snapshot)
 	{
 		auto cmd = _context->allocate_command_list();
 
@@ -1,5 +1,7 @@
 #include "pch.h"
 
+#include <format>
+
 #include "DMCamera.h"
 #include "DMRenderer.h"
 #include "DMUtilities.h"
@@ -23,15 +25,19 @@ namespace dm::renderer
         core::utility::SubdivideGrid_Internal(4, _terrainLowLod);
 	}
 
-	void Renderer::RenderTerrain(model::WorldModel* pWorld)
+	void Renderer::RenderTerrain(const model::WorldSnapshot& snapshot)
 	{
 		static bool doWireframe = false;
 		{
 			ImGui::Begin("Terrain render pass settings");
 			ImGui::Checkbox("Wireframe", &doWireframe);
+			ImGui::Text(std::format("Terrain tiles uploaded last frame: {}", _tilesUploaded).c_str());
+			ImGui::Text(std::format("Splat upload: {}", snapshot.splatBlocks.width != 0 ? "BC7" : "RGBA8").c_str());
+			ImGui::Text(std::format("Splat tiles encoded last time: {} in {:.2f} ms, max error {}, {} over tolerance",
+				_splatEncodeStats.tilesEncoded, _splatEncodeStats.milliseconds, _splatEncodeStats.maxError, _splatEncodeStats.tilesOverTolerance).c_str());
 			if (ImGui::Button("Calculate all terrain LODs (WARNING EXPENSIVE)"))
 			{
-				for (auto& cell : pWorld->cellStore)
+				for (auto& cell : snapshot.cells)
 				{
 					/*EnsureMeshLoaded(cell.highLod);
 					EnsureMeshLoaded(cell.mid2Lod);
@@ -42,30 +48,39 @@ namespace dm::renderer
 			ImGui::End();
 		}
 
-		if (pWorld->terrainHeightMap.heightMapDirty)
+		// switching height storage recreates the texture in the other format, forget what was uploaded in the old one
+		if (snapshot.quantizedHeights.width != 0)
 		{
-			RebuildHeightmap(&pWorld->terrainHeightMap);
+			_uploadedHeights = {};
+			_tilesUploaded = UpdateTerrainLayer(snapshot.quantizedHeights, _uploadedQuantizedHeights, _heightMap, dm3d::R16_UNORM, "HeightMap");
 		}
-
-		if (pWorld->terrainHeightMap.overlayDirty)
+		else
 		{
-			RebuildHeightmapOverlay(&pWorld->terrainHeightMap);
+			_uploadedQuantizedHeights = {};
+			_tilesUploaded = UpdateTerrainLayer(snapshot.heights, _uploadedHeights, _heightMap, dm3d::R32_FLOAT, "HeightMap");
 		}
-
-		if (pWorld->terrainHeightMap.splatDirty)
+		_tilesUploaded += UpdateTerrainLayer(snapshot.normals, _uploadedNormals, _terrainNormalMap, dm3d::R8G8_SNORM, "TerrainNormalMap");
+		_tilesUploaded += UpdateTerrainLayer(snapshot.overlay, _uploadedOverlay, _heightMapOverlay, dm3d::R8G8B8A8_UNORM, "HeightMapOverlay");
+		// same for the splat switching between blocks and plain texels
+		if (snapshot.splatBlocks.width != 0)
+		{
+			_uploadedSplat = {};
+			_tilesUploaded += UpdateTerrainLayer(snapshot.splatBlocks, _uploadedSplatBlocks, _heightMapSplat, dm3d::BC7_UNORM, "HeightMapSplat");
+		}
+		else
 		{
-			RebuildCellSplatMap(&pWorld->terrainHeightMap);
+			_uploadedSplatBlocks = {};
+			_tilesUploaded += UpdateTerrainLayer(snapshot.splat, _uploadedSplat, _heightMapSplat, dm3d::R8G8B8A8_UNORM, "HeightMapSplat");
 		}
+		if (snapshot.splatEncodeStats.tilesEncoded != 0)
+			_splatEncodeStats = snapshot.splatEncodeStats;
 
 		auto vertexShader = _shaderCache->GetShader("TerrainVertexShader.cso", dm3d::ShaderStage::Vertex);
 		auto pixelShader = _shaderCache->GetShader("TerrainPixelShader.cso", dm3d::ShaderStage::Pixel);
 
-		auto camera = std::dynamic_pointer_cast<core::Camera>(pWorld->globalObjectStore[pWorld->activeCamera]);
-		auto viewMatrix = camera->GetViewMatrix();
-		auto projMatrix = camera->GetProjectionMatrix();
-		auto viewProj = projMatrix * viewMatrix;
+		auto viewProj = snapshot.camera.projection * snapshot.camera.view;
 
-		SceneData sceneData{ .vp = viewProj };
+		SceneData sceneData{ .vp = viewProj, .heightScale = snapshot.heightScale, .heightOffset = snapshot.heightOffset };
 		auto sceneDataBuffer = _context->build_constant(sceneData, false);
 
 		auto cmd = _context->allocate_command_list();
@@ -91,11 +106,12 @@ namespace dm::renderer
 		cmd->set_vertex(vertexShader);
 		cmd->set_pixel(pixelShader);
 
-		auto camPos = camera->position;
+		auto camPos = snapshot.camera.position;
 		camPos.y = 0.f;
 
-		for (auto& cell : pWorld->cellStore)
+		for (auto& pCell : snapshot.cells)
 		{
+			auto& cell = *pCell;
 			std::shared_ptr<dm3d::Buffer> vertexBuffer;
 			std::shared_ptr<dm3d::IndexBuffer> indexBuffer;
 			uint32_t indexCount;
@@ -142,7 +158,7 @@ namespace dm::renderer
                 drawDataBuffer->unmap();
 			}
 
-			TerrainResourceTable resourceTable{ .pVertexBuffer = vertexBuffer->get_structured_index(), .pSceneData = sceneDataBuffer->get_constant_index(), .pHeightMap = _heightMap->get_structured_index(), .pCellDrawData = drawDataBuffer->get_constant_index(), .pHeightMapOverlay = _heightMapOverlay->get_structured_index(), .pSplatMap = _heightMapSplat->get_structured_index() };
+			TerrainResourceTable resourceTable{ .pVertexBuffer = vertexBuffer->get_structured_index(), .pSceneData = sceneDataBuffer->get_constant_index(), .pHeightMap = _heightMap->get_structured_index(), .pNormalMap = _terrainNormalMap->get_structured_index(), .pCellDrawData = drawDataBuffer->get_constant_index(), .pHeightMapOverlay = _heightMapOverlay->get_structured_index(), .pSplatMap = _heightMapSplat->get_structured_index() };
 			
 			cmd->try_defer_transition(vertexBuffer, dm3d::ResourceState::ShaderRead);
 
@@ -155,61 +171,56 @@ namespace dm::renderer
 		_context->submit_list(std::move(cmd));
 	}
 
-	void Renderer::RebuildHeightmap(model::TerrainHeightMap* pHeightMap)
+	template <typename T, size_t TileSize>
+	size_t Renderer::UpdateTerrainLayer(const model::TerrainLayerSnapshot<T, TileSize>& layer, model::TerrainLayerSnapshot<T, TileSize>& uploaded,
+		std::shared_ptr<dm3d::Image>& image, dm3d::ImageFormat format, const char* name)
 	{
-		auto heightMapWidth = pHeightMap->GetWidth();
-		auto& floatData = pHeightMap->GetFloatData();
-		std::vector<float> flatData(heightMapWidth * heightMapWidth);
-
-		for (size_t y = 0; y < heightMapWidth; y++)
-		{
-			memcpy(&flatData[y * heightMapWidth], floatData[y].data(), heightMapWidth * sizeof(float));
-		}
-
-		_heightMap = _context->create_image(dm3d::Extent3D{ .width = static_cast<uint32_t>(heightMapWidth), .height = static_cast
-			                                    <uint32_t>(heightMapWidth), .depth = 1 }, dm3d::R32_FLOAT, dm3d::None, dm3d::ResourceState::ShaderRead, "HeightMap");
-		_context->register_image_view(_heightMap);
-
-		_context->copy_image(flatData.data(), _heightMap);
+		if (layer.revision == uploaded.revision && image != nullptr)
+			return 0;
 
-		pHeightMap->heightMapDirty = false;
-	}
-
-	void Renderer::RebuildHeightmapOverlay(model::TerrainHeightMap* pHeightMap)
-	{
-		auto heightMapWidth = pHeightMap->GetWidth();
-		auto& rawData = pHeightMap->GetOverlayData();
-		std::vector<DMR8G8B8A8Pixel> flatData(heightMapWidth * heightMapWidth);
+		// texels per layer value along each side
+		size_t blockWidth = 1;
+		if constexpr (requires { T::blockWidth; })
+			blockWidth = T::blockWidth;
 
-		for (size_t y = 0; y < heightMapWidth; y++)
+		// first upload or a resize, the texture has to be created anyway. a switch between layers of a different format
+		// starts from an empty uploaded layer, so it lands here too
+		if (image == nullptr || layer.width != uploaded.width)
 		{
-			memcpy(&flatData[y * heightMapWidth], rawData[y].data(), heightMapWidth * sizeof(DMR8G8B8A8Pixel));
-		}
-
-		_heightMapOverlay = _context->create_image(dm3d::Extent3D{ .width = static_cast<uint32_t>(heightMapWidth), .height = static_cast<uint32_t>(heightMapWidth), .depth = 1 },
-			dm3d::R8G8B8A8_UNORM);
-		_context->register_image_view(_heightMapOverlay);
-		_context->copy_image(flatData.data(), _heightMapOverlay);
+			std::vector<T> flatData(layer.width * layer.width);
+			layer.CopyTo(flatData.data());
 
-		pHeightMap->overlayDirty = false;
-	}
+			const auto width = static_cast<uint32_t>(layer.width * blockWidth);
+			image = _context->create_image(dm3d::Extent3D{ .width = width, .height = width, .depth = 1 }, format, dm3d::None, dm3d::ResourceState::ShaderRead, name);
+			_context->register_image_view(image);
+			_context->copy_image(flatData.data(), image);
 
-	void Renderer::RebuildCellSplatMap(model::TerrainHeightMap* pHeightMap)
-	{
-		auto& rawData = pHeightMap->GetSplatData();
-		auto splatWidth = rawData.size();
-		std::vector<DMR8G8B8A8Pixel> flatData(splatWidth * splatWidth);
+			uploaded = layer;
+			return layer.tiles.size();
+		}
 
-		for (size_t y = 0; y < splatWidth; y++)
+		// tiles are immutable once published, so the same pointer means the same texels. tiles are stored packed, they upload as is
+		std::vector<dm3d::ImageRegion> regions;
+		for (size_t t = 0; t < layer.tiles.size(); t++)
 		{
-			memcpy(&flatData[y * splatWidth], rawData[y].data(), splatWidth * sizeof(DMR8G8B8A8Pixel));
+			if (layer.tiles[t] == uploaded.tiles[t])
+				continue;
+
+			const auto tileX = t % layer.tilesPerRow;
+			const auto tileZ = t / layer.tilesPerRow;
+			regions.push_back(dm3d::ImageRegion{
+				.x = static_cast<uint32_t>(tileX * layer.tileSize * blockWidth),
+				.y = static_cast<uint32_t>(tileZ * layer.tileSize * blockWidth),
+				.width = static_cast<uint32_t>(layer.TileWidth(tileX) * blockWidth),
+				.height = static_cast<uint32_t>(layer.TileWidth(tileZ) * blockWidth),
+				.data = layer.tiles[t]->data(),
+				.rowPitch = layer.TileWidth(tileX) * sizeof(T) });
 		}
 
-		_heightMapSplat = _context->create_image(dm3d::Extent3D{ .width = static_cast<uint32_t>(splatWidth), .height = static_cast<uint32_t>(splatWidth), .depth = 1 }, dm3d::R8G8B8A8_UNORM);
-		_context->register_image_view(_heightMapSplat);
-		_context->copy_image(flatData.data(), _heightMapSplat);
+		_context->copy_image_regions(regions, image);
 
-		pHeightMap->splatDirty = false;
+		uploaded = layer;
+		return regions.size();
 	}
 
 	std::optional<Renderer::SplatPack> Renderer::GetSplatPack(const model::Cell& pCell) const
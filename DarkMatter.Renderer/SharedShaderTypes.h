@@ -6,6 +6,9 @@
 struct SceneData
 {
 	float4x4 vp;
+	// height map texels decode as sample * heightScale + heightOffset
+	float heightScale;
+	float heightOffset;
 };
 
 struct TerrainCellDrawData
@@ -22,6 +25,8 @@ struct TerrainResourceTable
 	uint pVertexBuffer;
 	uint pSceneData;
 	uint pHeightMap;
+	// hemi-octahedral RG8_SNORM, see model::PackedNormal
+	uint pNormalMap;
 	uint pCellDrawData;
 	uint pHeightMapOverlay;
 	uint pSplatMap;
@@ -62,20 +62,13 @@ float4 UvShuffle(float2 uv, Texture2D tex)
     return lerp(mixAB, mixCD, b.y);
 }
 
-float3 ComputeNormal(float2 uv)
+float3 SampleNormal(float2 uv)
 {
-    float texelSize = 1.0 / 1024.0;
-    Texture2D heightMap = ResourceDescriptorHeap[resources.pHeightMap];
-    float heightL = heightMap.SampleLevel(heightSampler, uv - float2(texelSize, 0), 0).r;
-    float heightR = heightMap.SampleLevel(heightSampler, uv + float2(texelSize, 0), 0).r;
-    float heightD = heightMap.SampleLevel(heightSampler, uv - float2(0, texelSize), 0).r;
-    float heightU = heightMap.SampleLevel(heightSampler, uv + float2(0, texelSize), 0).r;
-
-    float dX = heightR - heightL;
-    float dZ = heightU - heightD;
-
-    float3 normal = normalize(float3(-dX, 2.0, -dZ));
-    return normal;
+    // the model packs the normals on the CPU, unpacking is a rotation and the octahedron's y
+    Texture2D normalMap = ResourceDescriptorHeap[resources.pNormalMap];
+    float2 packed = normalMap.SampleLevel(heightSampler, uv, 0).xy;
+    float2 p = float2(packed.x + packed.y, packed.x - packed.y) * 0.5;
+    return normalize(float3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y));
 }
 
 float4 GetSplatColor(float2 uv)
@@ -105,7 +98,7 @@ float4 main(TerrainVertexOut input) : SV_TARGET
 
     float4 splatColor = GetSplatColor(input.heightMapUv);
 
-    float3 normal = ComputeNormal(input.heightMapUv);
+    float3 normal = SampleNormal(input.heightMapUv);
 
     float4 finalColor = splatColor + overlayColor;
 
@@ -28,7 +28,7 @@ TerrainVertexOut main(uint vertexId : SV_VertexID)
 	}
 	else
 	{
-		output.position = mul(sceneData.vp, float4(worldPos.x, heightSample.x, worldPos.z, 1));
+		output.position = mul(sceneData.vp, float4(worldPos.x, heightSample.x * sceneData.heightScale + sceneData.heightOffset, worldPos.z, 1));
 	}
 	output.heightMapUv = sampleUV;
 
@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dm::bench::legacy
+{
+	// The task system as it was before the work stealing scheduler, kept here as the baseline the bench measures against.
+	// Only the worker count is taken from the caller so both systems run with the same number of threads, and re-queued
+	// jobs are counted.
+
+	class SyncCounter
+	{
+	public:
+		SyncCounter() = default;
+
+		SyncCounter(const SyncCounter& other) = delete;
+
+		void Increment()
+		{
+			++_internalCounter;
+		}
+
+		void Decrement()
+		{
+			--_internalCounter;
+		}
+
+		[[nodiscard]] bool IsZero() const
+		{
+			return _internalCounter.load() == 0;
+		}
+
+	private:
+		std::atomic<uint32_t> _internalCounter{ 0 };
+	};
+
+	class NotificationQueue
+	{
+	public:
+		bool TryPop(std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>& func)
+		{
+			std::unique_lock<std::mutex> lock{ _mutex, std::try_to_lock };
+			if (!lock || _q.empty()) return false;
+			func = std::move(_q.front());
+			_q.pop_front();
+			return true;
+		}
+
+		template <typename F>
+		bool TryPush(F&& f, const std::shared_ptr<SyncCounter>& fence)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ _mutex, std::try_to_lock };
+				if (!lock) return false;
+				_q.emplace_back(std::pair(fence, std::forward<F>(f)));
+			}
+
+			_ready.notify_one();
+			return true;
+		}
+
+		bool Pop(std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>& func)
+		{
+			std::unique_lock<std::mutex> lock{ _mutex };
+			while (_q.empty() && !_done) _ready.wait(lock);
+			if (_q.empty()) return false;
+			func = std::move(_q.front());
+			_q.pop_front();
+			return true;
+		}
+
+		template <typename F>
+		void Push(F&& f, const std::shared_ptr<SyncCounter>& fence)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ _mutex };
+				_q.emplace_back(std::pair(fence, std::forward<F>(f)));
+			}
+			_ready.notify_one();
+		}
+
+		void Done()
+		{
+			{
+				std::unique_lock<std::mutex> lock{ _mutex };
+				_done = true;
+			}
+			_ready.notify_all();
+		}
+
+	private:
+		std::deque<std::pair<std::shared_ptr<SyncCounter>, std::function<void()>>> _q;
+		bool _done{ false };
+		std::mutex _mutex;
+		std::condition_variable _ready;
+	};
+
+	class TaskSystem
+	{
+	public:
+		explicit TaskSystem(uint32_t workerCount)
+			: _count(std::max(workerCount, 1u))
+		{
+			for (uint32_t i = 0; i != _count; i++)
+			{
+				_threads.emplace_back([&, i] { Run(i); });
+			}
+		}
+
+		~TaskSystem()
+		{
+			for (auto& q : _q)
+			{
+				q.Done();
+			}
+
+			for (auto& t : _threads)
+			{
+				t.join();
+			}
+		}
+
+		// every job needs a counter, pass one that stays at zero for jobs without a dependency
+		template <typename F>
+		void async_(F&& f, std::shared_ptr<SyncCounter> dep)
+		{
+			auto i = _index++;
+
+			for (uint32_t n = 0; n != _count * _k; ++n)
+			{
+				if (_q[(i + n) % _count].TryPush(std::forward<F>(f), dep)) return;
+			}
+
+			_q[i % _count].Push(std::forward<F>(f), dep);
+		}
+
+		uint32_t GetWorkerCount() const { return _count; }
+		uint64_t GetRequeued() const { return _requeued.load(); }
+
+	private:
+		const uint32_t _count;
+
+		std::vector<std::thread> _threads;
+		std::vector<NotificationQueue> _q{ _count };
+		std::atomic<uint32_t> _index{ 0 };
+		std::atomic<uint64_t> _requeued{ 0 };
+		static constexpr uint32_t _k = 5;
+
+		void PushAny(const std::function<void()>& f, const std::shared_ptr<SyncCounter>& fenceVal)
+		{
+			const auto i = _index++;
+
+			for (uint32_t n = 0; n != _count * _k; ++n)
+			{
+				if (_q[(i + n) % _count].TryPush(f, fenceVal)) return;
+			}
+
+			_q[i % _count].Push(f, fenceVal);
+		}
+
+		void Run(const uint32_t i)
+		{
+			while (true)
+			{
+				bool gotFunc = false;
+				std::pair<std::shared_ptr<SyncCounter>, std::function<void()>> f;
+
+				for (uint32_t n = 0; n != _count; ++n)
+				{
+					if (_q[(i + n) % _count].TryPop(f))
+					{
+						gotFunc = true;
+						break;
+					}
+				}
+
+				if (!gotFunc && !_q[i].Pop(f)) break;
+
+				if (!f.first->IsZero())
+				{
+					++_requeued;
+					PushAny(f.second, f.first);
+				}
+				else
+				{
+					f.second();
+				}
+			}
+		}
+	};
+}
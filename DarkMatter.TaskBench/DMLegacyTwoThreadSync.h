@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+
+namespace dm::bench::legacy
+{
+	// The handshake as it was before it learned to sleep, both sides spin until the other one gets there. Kept as the
+	// baseline for the handoff bench.
+	class TwoThreadSync
+	{
+	public:
+		void Lock()
+		{
+			_lockRequested = true;
+			while (!_locked){}
+		}
+
+		void Unlock()
+		{
+			_lockRequested = false;
+			while (_locked){}
+		}
+
+		void AcknowledgeLock()
+		{
+			if (_lockRequested)
+			{
+				_locked = true;
+				while (_lockRequested){}
+				_locked = false;
+			}
+		}
+	private:
+		std::atomic<bool> _lockRequested = false;
+		std::atomic<bool> _locked = false;
+	};
+}
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "DMLegacyTaskSystem.h"
+#include "DMLegacyTwoThreadSync.h"
+#include "DMTaskSystem.h"
+#include "DMTwoThreadSync.h"
+
+// Measures the task system against the NotificationQueue scheduler it replaced. Both run with the same worker count, jobs
+// are submitted the same way and completion is waited for the same way, so the numbers only differ by the scheduler.
+// Then the same for TwoThreadSync against the spinning handshake it replaced.
+
+using namespace dm;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr uint32_t throughputJobs = 1'000'000;
+	// binary tree of jobs that submit their children from the workers
+	constexpr uint32_t fanOutDepth = 18;
+	constexpr uint32_t latencySamples = 10'000;
+	// chains of jobs that each wait on the one before, all submitted before the first gate opens
+	constexpr uint32_t gatedChains = 200;
+	constexpr uint32_t gatedChainLength = 200;
+	// the editor side locks this often, the engine side acknowledges once per simulated frame
+	constexpr uint32_t handoffs = 1'000;
+	constexpr auto handoffFrame = std::chrono::milliseconds(1);
+	// time spent holding the lock, and between two locks
+	constexpr auto handoffHold = std::chrono::microseconds(100);
+	constexpr auto handoffPause = std::chrono::microseconds(500);
+
+	// The last job to finish wakes the submitting thread, it doesn't help or spin. It outlives the schedulers, the last job
+	// can still be in notify_all after the waiter has returned.
+	struct Completion
+	{
+		std::atomic<uint32_t> remaining{ 0 };
+
+		void Reset(uint32_t count) { remaining = count; }
+
+		void Done()
+		{
+			if (--remaining == 0)
+				remaining.notify_all();
+		}
+
+		void Wait()
+		{
+			while (const auto left = remaining.load())
+			{
+				remaining.wait(left);
+			}
+		}
+	};
+
+	// the two schedulers behind one submit call
+	struct NewScheduler
+	{
+		using Counter = core::task::SyncCounter;
+
+		core::task::TaskSystem& system;
+
+		template <typename F>
+		void Submit(F&& f) { system.async_(std::forward<F>(f)); }
+
+		template <typename F>
+		void SubmitAfter(F&& f, std::shared_ptr<Counter> dep) { system.async_(std::forward<F>(f), std::move(dep)); }
+
+		static std::shared_ptr<Counter> MakeCounter() { return core::task::MakeSyncCounter(); }
+		uint64_t GetParked() const { return system.GetStats().parked; }
+		uint64_t GetRequeued() const { return 0; }
+	};
+
+	struct LegacyScheduler
+	{
+		using Counter = bench::legacy::SyncCounter;
+
+		bench::legacy::TaskSystem& system;
+		std::shared_ptr<Counter> none = std::make_shared<Counter>();
+
+		template <typename F>
+		void Submit(F&& f) { system.async_(std::forward<F>(f), none); }
+
+		template <typename F>
+		void SubmitAfter(F&& f, std::shared_ptr<Counter> dep) { system.async_(std::forward<F>(f), std::move(dep)); }
+
+		static std::shared_ptr<Counter> MakeCounter() { return std::make_shared<Counter>(); }
+		uint64_t GetParked() const { return 0; }
+		uint64_t GetRequeued() const { return system.GetRequeued(); }
+	};
+
+	// many small jobs from one thread outside the pool, the way the engine and render threads submit
+	template <typename Scheduler>
+	double Throughput(Scheduler& scheduler, Completion& completion)
+	{
+		completion.Reset(throughputJobs);
+		const auto start = Clock::now();
+		for (uint32_t i = 0; i < throughputJobs; i++)
+		{
+			scheduler.Submit([&completion] { completion.Done(); });
+		}
+
+		completion.Wait();
+		return throughputJobs / std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	template <typename Scheduler>
+	void Spawn(Scheduler& scheduler, Completion& completion, uint32_t depth)
+	{
+		if (depth > 0)
+		{
+			scheduler.Submit([&scheduler, &completion, depth] { Spawn(scheduler, completion, depth - 1); });
+			scheduler.Submit([&scheduler, &completion, depth] { Spawn(scheduler, completion, depth - 1); });
+		}
+
+		completion.Done();
+	}
+
+	// jobs submitting jobs from the workers, the way parallel_for and continuations do
+	template <typename Scheduler>
+	double FanOut(Scheduler& scheduler, Completion& completion)
+	{
+		const uint32_t jobs = (2u << fanOutDepth) - 1;
+		completion.Reset(jobs);
+		const auto start = Clock::now();
+		scheduler.Submit([&scheduler, &completion] { Spawn(scheduler, completion, fanOutDepth); });
+
+		completion.Wait();
+		return jobs / std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	struct Latency
+	{
+		double median;
+		double p99;
+	};
+
+	// submit to start of one job on an idle pool, so this includes waking a sleeping worker
+	template <typename Scheduler>
+	Latency SubmitLatency(Scheduler& scheduler, Completion& completion)
+	{
+		std::vector<double> samples(latencySamples);
+		for (auto& sample : samples)
+		{
+			completion.Reset(1);
+			Clock::time_point started;
+			const auto submitted = Clock::now();
+			scheduler.Submit([&completion, &started] { started = Clock::now(); completion.Done(); });
+
+			completion.Wait();
+			sample = std::chrono::duration<double, std::micro>(started - submitted).count();
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+
+		std::ranges::sort(samples);
+		return Latency{ .median = samples[samples.size() / 2], .p99 = samples[samples.size() * 99 / 100] };
+	}
+
+	struct GatedResult
+	{
+		double milliseconds;
+		uint64_t parked;
+		uint64_t requeued;
+		uint32_t outOfOrder;
+	};
+
+	template <typename Counter>
+	struct GatedChains
+	{
+		// gate c * gatedChainLength + i holds back job i of chain c, the job before it opens it
+		std::vector<std::shared_ptr<Counter>> gates;
+		std::vector<uint32_t> next = std::vector<uint32_t>(gatedChains, 0);
+		std::atomic<uint32_t> outOfOrder{ 0 };
+	};
+
+	// Every job but the first of each chain is blocked when it's submitted, the way continuations sit behind loads. The
+	// notification scheduler cycles blocked jobs through its queues until their counter reaches zero.
+	template <typename Scheduler>
+	GatedResult Gated(Scheduler& scheduler, Completion& completion)
+	{
+		GatedChains<typename Scheduler::Counter> chains;
+		for (uint32_t i = 0; i < gatedChains * gatedChainLength; i++)
+		{
+			chains.gates.push_back(Scheduler::MakeCounter());
+			chains.gates.back()->Increment();
+		}
+
+		const auto parked = scheduler.GetParked();
+		const auto requeued = scheduler.GetRequeued();
+		completion.Reset(gatedChains * gatedChainLength);
+		for (uint32_t c = 0; c < gatedChains; c++)
+		{
+			for (uint32_t i = 0; i < gatedChainLength; i++)
+			{
+				scheduler.SubmitAfter([&chains, &completion, c, i]
+					{
+						if (chains.next[c]++ != i)
+							++chains.outOfOrder;
+
+						if (i + 1 < gatedChainLength)
+							chains.gates[c * gatedChainLength + i + 1]->Decrement();
+
+						completion.Done();
+					}, chains.gates[c * gatedChainLength + i]);
+			}
+		}
+
+		const auto start = Clock::now();
+		for (uint32_t c = 0; c < gatedChains; c++)
+		{
+			chains.gates[c * gatedChainLength]->Decrement();
+		}
+
+		completion.Wait();
+		return GatedResult{ .milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count(), .parked = scheduler.GetParked() - parked,
+			.requeued = scheduler.GetRequeued() - requeued, .outOfOrder = chains.outOfOrder.load() };
+	}
+
+	template <typename Scheduler>
+	void RunAll(const char* name, Scheduler& scheduler, Completion& completion)
+	{
+		// a first pass to warm the job pools and the queues
+		Throughput(scheduler, completion);
+
+		const auto throughput = Throughput(scheduler, completion);
+		const auto fanOut = FanOut(scheduler, completion);
+		const auto latency = SubmitLatency(scheduler, completion);
+		const auto gated = Gated(scheduler, completion);
+		std::printf("%-14s %14.0f %14.0f %14.1f %14.1f %14.1f %14llu %14llu %14u\n", name, throughput, fanOut, latency.median, latency.p99, gated.milliseconds,
+			static_cast<unsigned long long>(gated.parked), static_cast<unsigned long long>(gated.requeued), gated.outOfOrder);
+	}
+
+	// user and kernel time of the whole process
+	double ProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+		const auto ticks = [](const FILETIME& t) { return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+		return (ticks(kernel) + ticks(user)) * 1e-7;
+#else
+		return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+	}
+
+	// One thread plays the engine and acknowledges once per frame, this one plays the editor and locks, holds the lock for
+	// a moment and lets go. Lock latency is mostly waiting for the end of the engine's frame, the interesting number is the
+	// CPU time both sides burn meanwhile.
+	template <typename Sync>
+	void Handoff(const char* name)
+	{
+		Sync sync;
+		std::atomic<bool> quit{ false };
+		std::thread engine([&sync, &quit]
+			{
+				while (!quit)
+				{
+					std::this_thread::sleep_for(handoffFrame);
+					sync.AcknowledgeLock();
+				}
+			});
+
+		std::vector<double> lockMicroseconds(handoffs);
+		std::vector<double> unlockMicroseconds(handoffs);
+		const auto cpu = ProcessCpuSeconds();
+		const auto start = Clock::now();
+		for (uint32_t i = 0; i < handoffs; i++)
+		{
+			const auto requested = Clock::now();
+			sync.Lock();
+			lockMicroseconds[i] = std::chrono::duration<double, std::micro>(Clock::now() - requested).count();
+
+			std::this_thread::sleep_for(handoffHold);
+
+			const auto released = Clock::now();
+			sync.Unlock();
+			unlockMicroseconds[i] = std::chrono::duration<double, std::micro>(Clock::now() - released).count();
+
+			std::this_thread::sleep_for(handoffPause);
+		}
+
+		const auto wall = std::chrono::duration<double>(Clock::now() - start).count();
+		const auto cpuSeconds = ProcessCpuSeconds() - cpu;
+		quit = true;
+		engine.join();
+
+		std::ranges::sort(lockMicroseconds);
+		std::ranges::sort(unlockMicroseconds);
+		std::printf("%-14s %14.1f %14.1f %14.1f %14.3f %14.2f\n", name, lockMicroseconds[handoffs / 2], lockMicroseconds[handoffs * 99 / 100],
+			unlockMicroseconds[handoffs / 2], cpuSeconds * 1e3 / handoffs, cpuSeconds / wall);
+	}
+}
+
+int main()
+{
+	Completion completion;
+	auto* pTaskSystem = new core::task::TaskSystem();
+	core::task::GTaskSystem = pTaskSystem;
+	const auto workers = pTaskSystem->GetWorkerCount();
+
+	std::printf("%u workers, %u external jobs, %u fan out jobs, %u latency samples, %u x %u gated jobs\n\n", workers, throughputJobs, (2u << fanOutDepth) - 1,
+		latencySamples, gatedChains, gatedChainLength);
+	std::printf("%-14s %14s %14s %14s %14s %14s %14s %14s %14s\n", "scheduler", "external/s", "fan out/s", "latency us", "p99 us", "gated ms", "parked",
+		"re-queued", "out of order");
+
+	{
+		NewScheduler scheduler{ *pTaskSystem };
+		RunAll("work stealing", scheduler, completion);
+	}
+
+	core::task::GTaskSystem = nullptr;
+	delete pTaskSystem;
+
+	{
+		bench::legacy::TaskSystem legacy(workers);
+		LegacyScheduler scheduler{ legacy };
+		RunAll("notification", scheduler, completion);
+	}
+
+	std::printf("\n%u handoffs, %lld ms frames\n\n", handoffs, static_cast<long long>(handoffFrame.count()));
+	std::printf("%-14s %14s %14s %14s %14s %14s\n", "handshake", "lock us", "lock p99 us", "unlock us", "cpu ms/lock", "cores busy");
+	Handoff<core::TwoThreadSync>("spin then wait");
+	Handoff<bench::legacy::TwoThreadSync>("spin");
+
+	return 0;
+}
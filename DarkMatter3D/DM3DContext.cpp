@@ -812,10 +812,12 @@ namespace dm3d
 
 		check_result(hr);
 
+		// rows of blocks for block compressed formats
+		const auto blockWidth = D3D12_Translator::format_block_width(image->get_d3d12_format());
 		D3D12_SUBRESOURCE_DATA textureData = {};
 		textureData.pData = data;
-		textureData.RowPitch = image->get_width() * D3D12_Translator::format_stride(image->get_d3d12_format());
-		textureData.SlicePitch = textureData.RowPitch * image->get_height();
+		textureData.RowPitch = image->get_width() / blockWidth * D3D12_Translator::format_stride(image->get_d3d12_format());
+		textureData.SlicePitch = textureData.RowPitch * (image->get_height() / blockWidth);
 
 		auto tempList = allocate_raw_command_list();
 
@@ -836,6 +838,105 @@ namespace dm3d
 		uploadAllocation->Release();
 	}
 
+	void Context::copy_image_regions(std::span<const ImageRegion> regions, std::shared_ptr<Image> image)
+	{
+		if (regions.empty())
+			return;
+
+		const auto format = image->get_d3d12_format();
+		const auto texelSize = D3D12_Translator::format_stride(format);
+		// block compressed regions are copied a row of blocks at a time, region sizes are in texels and multiples of it
+		const auto blockWidth = D3D12_Translator::format_block_width(format);
+
+		// every region gets its own placed footprint in the upload buffer, rows padded to the copy pitch alignment
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(regions.size());
+		UINT64 uploadBufferSize = 0;
+		for (size_t i = 0; i < regions.size(); i++)
+		{
+			const auto& region = regions[i];
+			const UINT rowPitch = (region.width / blockWidth * texelSize + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+
+			uploadBufferSize = (uploadBufferSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~UINT64(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+			footprints[i].Offset = uploadBufferSize;
+			footprints[i].Footprint = { format, region.width, region.height, 1, rowPitch };
+			uploadBufferSize += UINT64(rowPitch) * (region.height / blockWidth);
+		}
+
+		D3D12_RESOURCE_DESC uploadBufferDesc = {};
+		uploadBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		uploadBufferDesc.Alignment = 0;
+		uploadBufferDesc.Width = uploadBufferSize;
+		uploadBufferDesc.Height = 1;
+		uploadBufferDesc.DepthOrArraySize = 1;
+		uploadBufferDesc.MipLevels = 1;
+		uploadBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uploadBufferDesc.SampleDesc.Count = 1;
+		uploadBufferDesc.SampleDesc.Quality = 0;
+		uploadBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		uploadBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		D3D12MA::Allocation* uploadAllocation;
+		ID3D12Resource* uploadBuffer;
+
+		D3D12MA::ALLOCATION_DESC uploadAllocDesc = {};
+		uploadAllocDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+		HRESULT hr = _allocator->CreateResource(&uploadAllocDesc, &uploadBufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr, &uploadAllocation, IID_PPV_ARGS(&uploadBuffer));
+
+		check_result(hr);
+
+		BYTE* pMapped;
+		hr = uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pMapped));
+
+		check_result(hr);
+
+		for (size_t i = 0; i < regions.size(); i++)
+		{
+			const auto& region = regions[i];
+			const auto* pSrc = static_cast<const BYTE*>(region.data);
+			for (UINT row = 0; row < region.height / blockWidth; row++)
+			{
+				memcpy(pMapped + footprints[i].Offset + SIZE_T(footprints[i].Footprint.RowPitch) * row, pSrc + region.rowPitch * row, region.width / blockWidth * texelSize);
+			}
+		}
+		uploadBuffer->Unmap(0, nullptr);
+
+		auto tempList = allocate_raw_command_list();
+
+		auto oldState = image->_currentState;
+
+		if (oldState != D3D12_RESOURCE_STATE_COPY_DEST)
+		{
+			transition_resource(tempList.Get(), image->get_d3d12_resource(), oldState, D3D12_RESOURCE_STATE_COPY_DEST);
+		}
+
+		for (size_t i = 0; i < regions.size(); i++)
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst = {};
+			dst.pResource = image->get_d3d12_resource();
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = 0;
+
+			D3D12_TEXTURE_COPY_LOCATION src = {};
+			src.pResource = uploadBuffer;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint = footprints[i];
+
+			tempList->CopyTextureRegion(&dst, regions[i].x, regions[i].y, 0, &src, nullptr);
+		}
+
+		if (oldState != D3D12_RESOURCE_STATE_COPY_DEST)
+		{
+			transition_resource(tempList.Get(), image->get_d3d12_resource(), D3D12_RESOURCE_STATE_COPY_DEST, oldState);
+		}
+
+		submit_list_immediate(tempList);
+
+		uploadBuffer->Release();
+		uploadAllocation->Release();
+	}
+
 	void Context::copy_buffer(std::shared_ptr<Buffer> src, std::shared_ptr<Buffer> dst)
 	{
 		auto tempList = allocate_raw_command_list();
@@ -21,6 +21,7 @@
 #include <DirectXMath.h>
 #include <memory>
 #include <queue>
+#include <span>
 #include <string>
 #include "SDL3/SDL.h"
 
@@ -80,6 +81,8 @@ namespace dm3d
 
 		// buffer copy
 		void copy_image(void* data, std::shared_ptr<Image> image);
+		// writes each region into the existing image through one upload buffer and one submission
+		void copy_image_regions(std::span<const ImageRegion> regions, std::shared_ptr<Image> image);
 		void copy_buffer(std::shared_ptr<Buffer> src, std::shared_ptr<Buffer> dst);
 
 		// free stuff
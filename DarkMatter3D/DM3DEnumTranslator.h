@@ -48,6 +48,12 @@ namespace dm3d
 				return DXGI_FORMAT_R32_UINT;
 			case R32_FLOAT:
 				return DXGI_FORMAT_R32_FLOAT;
+			case R16_UNORM:
+				return DXGI_FORMAT_R16_UNORM;
+			case R8G8_SNORM:
+				return DXGI_FORMAT_R8G8_SNORM;
+			case BC7_UNORM:
+				return DXGI_FORMAT_BC7_UNORM;
 			}
 
 			throw std::runtime_error("out of range");
@@ -98,6 +104,7 @@ namespace dm3d
 			throw std::runtime_error("out of range");
 		}
 
+		// bytes per texel, or per block for block compressed formats
 		inline uint32_t format_stride(DXGI_FORMAT format)
 		{
 			switch (format)
@@ -112,11 +119,22 @@ namespace dm3d
 			case DXGI_FORMAT_R32_TYPELESS:
 			case DXGI_FORMAT_R32_FLOAT:
 				return 4;
+			case DXGI_FORMAT_R16_UNORM:
+			case DXGI_FORMAT_R8G8_SNORM:
+				return 2;
+			case DXGI_FORMAT_BC7_UNORM:
+				return 16;
 			default:
 				throw std::runtime_error("out of range");
 			}
 		}
 
+		// texels along each side of a block, 1 for formats that aren't block compressed
+		inline uint32_t format_block_width(DXGI_FORMAT format)
+		{
+			return format == DXGI_FORMAT_BC7_UNORM ? 4 : 1;
+		}
+
 		inline D3D12_PRIMITIVE_TOPOLOGY_TYPE topology(TopologyType type)
 		{
 			switch (type)
@@ -10,7 +10,11 @@ namespace dm3d
 		D32_FLOAT,
 		R32_TYPELESS,
 		R32_UINT,
-		R32_FLOAT
+		R32_FLOAT,
+		R16_UNORM,
+		R8G8_SNORM,
+		// 4 * 4 texel blocks of 16 bytes, width and height must be multiples of 4
+		BC7_UNORM
 	};
 
 	enum ResourceFlags
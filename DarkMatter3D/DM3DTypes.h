@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 
 namespace dm3d
@@ -16,6 +17,18 @@ namespace dm3d
 		uint32_t depth = 0;
 	};
 
+	// texels for a rectangle of an image, rows are rowPitch bytes apart in data. for block compressed images the
+	// rectangle is still in texels, block aligned, and data holds rows of blocks
+	struct ImageRegion
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		const void* data = nullptr;
+		size_t rowPitch = 0;
+	};
+
 	struct DarkMatter3DUsageStats
 	{
 		uint64_t availableMemory;
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "CCellSettingsDialog.h"
 
+#include <array>
+#include <optional>
+
 #include "CEngineManager.h"
 #include "DMEUtilities.h"
 
@@ -11,13 +14,16 @@ END_MESSAGE_MAP()
 CCellSettingsDialog::CCellSettingsDialog(uint32_t cellId, CWnd* pParent) : CDialogEx(IDD_DIALOG_CELL_SETTINGS, pParent)
 {
 	auto world = GlobalEngineManager->Engine()->GetWorld();
+	auto snapshot = GlobalEngineManager->Engine()->GetSnapshot();
 
-	if (world->cellStore.size() <= cellId)
+	if (world->cellStore.size() <= cellId || snapshot == nullptr || snapshot->cells.size() <= cellId)
 	{
 		throw std::runtime_error("Dialog: Invalid CellID");
 	}
 
+	// the live cell is only touched by the queued commit on the engine thread, the dialog reads the published copy
 	_cell = &world->cellStore[cellId];
+	_publishedCell = snapshot->cells[cellId];
 }
 
 void CCellSettingsDialog::OnOK()
@@ -29,29 +35,35 @@ void CCellSettingsDialog::OnOK()
 	uint32_t newTex3Idx = GetBoxDataU32(_comboTex3);
 	uint32_t newTex4Idx = GetBoxDataU32(_comboTex4);
 
-	uint32_t oldTex1Idx = _cell->GetTerrainTexture(0);
-	uint32_t oldTex2Idx = _cell->GetTerrainTexture(1);
-	uint32_t oldTex3Idx = _cell->GetTerrainTexture(2);
-	uint32_t oldTex4Idx = _cell->GetTerrainTexture(3);
-
 	dme::EditTransaction transaction;
 
 	auto pCell = _cell;
+	// commit sets all four textures, so only the last of several queued edits to this cell matters
+	transaction.target = pCell;
 
-	transaction.commit = [pCell, newTex1Idx, newTex2Idx, newTex3Idx, newTex4Idx]()
+	// taken by commit on the engine thread. the published cell can be behind edits that are queued but not applied
+	// yet, an undo has to put back what the cell held right before this edit. empty if the edit was collapsed into a
+	// later one to the same cell, that one's undo covers it
+	auto before = std::make_shared<std::optional<std::array<uint32_t, 4>>>();
+
+	transaction.commit = [pCell, newTex1Idx, newTex2Idx, newTex3Idx, newTex4Idx, before]()
 		{
+			*before = std::array{ pCell->GetTerrainTexture(0), pCell->GetTerrainTexture(1), pCell->GetTerrainTexture(2), pCell->GetTerrainTexture(3) };
 			pCell->SetTerrainTexture(0, newTex1Idx);
 			pCell->SetTerrainTexture(1, newTex2Idx);
 			pCell->SetTerrainTexture(2, newTex3Idx);
 			pCell->SetTerrainTexture(3, newTex4Idx);
 		};
 
-	transaction.rollback = [pCell, oldTex1Idx, oldTex2Idx, oldTex3Idx, oldTex4Idx]()
+	transaction.rollback = [pCell, before]()
 		{
-			pCell->SetTerrainTexture(0, oldTex1Idx);
-			pCell->SetTerrainTexture(1, oldTex2Idx);
-			pCell->SetTerrainTexture(2, oldTex3Idx);
-			pCell->SetTerrainTexture(3, oldTex4Idx);
+			if (!before->has_value())
+				return;
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				pCell->SetTerrainTexture(i, (**before)[i]);
+			}
 		};
 
 	GlobalEngineManager->SubmitTransaction(transaction);
@@ -81,10 +93,10 @@ BOOL CCellSettingsDialog::OnInitDialog()
 		idx++;
 	}
 
-	_comboTex1.SetCurSel(LocateTextureIdx(textures, _cell->GetTerrainTexture(0)));
-	_comboTex2.SetCurSel(LocateTextureIdx(textures, _cell->GetTerrainTexture(1)));
-	_comboTex3.SetCurSel(LocateTextureIdx(textures, _cell->GetTerrainTexture(2)));
-	_comboTex4.SetCurSel(LocateTextureIdx(textures, _cell->GetTerrainTexture(3)));
+	_comboTex1.SetCurSel(LocateTextureIdx(textures, _publishedCell->GetTerrainTexture(0)));
+	_comboTex2.SetCurSel(LocateTextureIdx(textures, _publishedCell->GetTerrainTexture(1)));
+	_comboTex3.SetCurSel(LocateTextureIdx(textures, _publishedCell->GetTerrainTexture(2)));
+	_comboTex4.SetCurSel(LocateTextureIdx(textures, _publishedCell->GetTerrainTexture(3)));
 
 	return TRUE;
 }
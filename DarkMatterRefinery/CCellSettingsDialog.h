@@ -21,6 +21,7 @@ protected:
 
 protected:
 	dm::model::Cell* _cell;
+	std::shared_ptr<const dm::model::Cell> _publishedCell;
 public:
 	CComboBox _comboTex1;
 	CComboBox _comboTex2;
@@ -100,12 +100,35 @@ void CEngineManager::Shutdown()
 	_engine->SaveToFolder("meta");
 }
 
-void CEngineManager::SubmitTransaction(dme::EditTransaction transaction)
+std::shared_future<void> CEngineManager::SubmitTransaction(dme::EditTransaction transaction)
 {
+	_redoStack = {};
 	_transactionStack.push(transaction);
-	LockEngine();
-	transaction.commit();
-	UnlockEngine();
+	return _engine->QueueEdit(transaction.target, transaction.commit);
+}
+
+std::shared_future<void> CEngineManager::Undo()
+{
+	if (_transactionStack.empty())
+		return {};
+
+	auto transaction = std::move(_transactionStack.top());
+	_transactionStack.pop();
+	auto done = _engine->QueueEdit(nullptr, transaction.rollback);
+	_redoStack.push(std::move(transaction));
+	return done;
+}
+
+std::shared_future<void> CEngineManager::Redo()
+{
+	if (_redoStack.empty())
+		return {};
+
+	auto transaction = std::move(_redoStack.top());
+	_redoStack.pop();
+	auto done = _engine->QueueEdit(transaction.target, transaction.commit);
+	_transactionStack.push(std::move(transaction));
+	return done;
 }
 
 void CEngineManager::LockEngine()
@@ -152,13 +175,18 @@ std::vector<dme::CellMeta> CEngineManager::GetCellData() const
 	if (_engine == nullptr)
 		return std::vector<dme::CellMeta>();
 
-	const auto& cells = _engine->GetWorld()->cellStore;
+	// called from the UI thread, read the published snapshot rather than the world the engine thread is updating
+	const auto snapshot = _engine->GetSnapshot();
+	if (snapshot == nullptr)
+		return std::vector<dme::CellMeta>();
+
+	const auto& cells = snapshot->cells;
 	std::vector<dme::CellMeta> response;
 	response.reserve(cells.size());
 
 	for (size_t i = 0; i < cells.size(); i++)
 	{
-		const auto& cell = cells[i];
+		const auto& cell = *cells[i];
 		dme::CellMeta meta;
 		meta.id = static_cast<uint32_t>(i);
 		meta.name = "Wilderness";
@@ -242,23 +270,13 @@ void CEngineManager::InitNewWorld()
 
 	_engine->SetWorldModel(std::move(world));
 
-	// TODO TEMP
+	// TODO TEMP, a saved world brings its own terrain
+	if (!_engine->GetFileSystem()->FileExists("meta/terrain.dmt"))
 	{
-		auto heightmapSize = _engine->GetFileSystem()->FileSize("test/Hydro.r32");
-		auto numFloats = heightmapSize / sizeof(float);
-		auto heightmapRaw = std::vector<float>(numFloats);
-		_engine->GetFileSystem()->ReadFile("test/Hydro.r32", reinterpret_cast<char*>(heightmapRaw.data()));
-
 		auto w = _engine->GetWorld();
 
-		auto& terrainFloats = w->terrainHeightMap.GetFloatData();
-
-		for (int x = 0; x < 1024; x++)
-		{
-			for (int y = 0; y < 1024; y++)
-			{
-				terrainFloats[x][y] = heightmapRaw[x + (y * 1024)] * 5000.f;
-			}
-		}
+		// the raw file is column major, the importer turns it into rows on the way in
+		w->terrainHeightMap.ImportRawHeights(_engine->GetFileSystem(), "test/Hydro.r32",
+			{ .format = dm::model::RawHeightFormat::R32Float, .columnMajor = true, .scale = 5000.f });
 	}
 }
@@ -11,6 +11,8 @@ namespace dme
 	{
 		std::function<void()> commit;
 		std::function<void()> rollback;
+		// object commit writes, lets back to back edits of the same object collapse into one. Leave null if commit only changes part of it
+		const void* target = nullptr;
 	};
 
 	struct TextureAssetMeta
@@ -34,7 +36,14 @@ public:
 	dm::Engine* Engine() const { return _engine.get(); }
 	void Init(HWND hWnd);
 	void Shutdown();
-	void SubmitTransaction(dme::EditTransaction transaction);
+	// queues the commit for the engine thread without stopping it, wait on the future if the result is needed right away
+	std::shared_future<void> SubmitTransaction(dme::EditTransaction transaction);
+	// rolls back the last submitted or redone transaction on the engine thread, an invalid future if there's nothing to undo
+	std::shared_future<void> Undo();
+	// commits the last undone transaction again, an invalid future if there's nothing to redo. submitting clears the redo stack
+	std::shared_future<void> Redo();
+	bool CanUndo() const { return !_transactionStack.empty(); }
+	bool CanRedo() const { return !_redoStack.empty(); }
 	void LockEngine();
 	void UnlockEngine();
     void Resize(int newWidth, int newHeight);
@@ -42,7 +51,9 @@ public:
 	std::vector<dme::CellMeta> GetCellData() const;
 	void ImportTexture(std::string path, std::string name);
 private:
+	// both only touched on the UI thread, the engine thread just runs what they queue
 	std::stack<dme::EditTransaction> _transactionStack;
+	std::stack<dme::EditTransaction> _redoStack;
     std::unique_ptr<dm::Engine> _engine;
     std::thread _engineThread;
 	dm::core::TwoThreadSync _engineSync;
@@ -10,6 +10,7 @@
 
 #include "CAssetView.h"
 #include "CBlankView.h"
+#include "CEngineManager.h"
 #include "CEngineView.h"
 #include "CImportPngDialog.h"
 #include "CWorldView.h"
@@ -27,6 +28,10 @@ BEGIN_MESSAGE_MAP(CMainFrame, CFrameWnd)
 	ON_WM_SETFOCUS()
 	ON_WM_SIZE()
 	ON_COMMAND(ID_IMPORT_PNG, &CMainFrame::OnImportPng)
+	ON_COMMAND(ID_EDIT_UNDO, &CMainFrame::OnEditUndo)
+	ON_COMMAND(ID_EDIT_REDO, &CMainFrame::OnEditRedo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO, &CMainFrame::OnUpdateEditUndo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_REDO, &CMainFrame::OnUpdateEditRedo)
 END_MESSAGE_MAP()
 
 static UINT indicators[] =
@@ -191,3 +196,23 @@ void CMainFrame::OnImportPng()
 		delete dialog;
 	}
 }
+
+void CMainFrame::OnEditUndo()
+{
+	GlobalEngineManager->Undo();
+}
+
+void CMainFrame::OnEditRedo()
+{
+	GlobalEngineManager->Redo();
+}
+
+void CMainFrame::OnUpdateEditUndo(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(GlobalEngineManager != nullptr && GlobalEngineManager->CanUndo());
+}
+
+void CMainFrame::OnUpdateEditRedo(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(GlobalEngineManager != nullptr && GlobalEngineManager->CanRedo());
+}
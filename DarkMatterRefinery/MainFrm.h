@@ -48,6 +48,10 @@ protected:
 
 public:
 	afx_msg void OnImportPng();
+	afx_msg void OnEditUndo();
+	afx_msg void OnEditRedo();
+	afx_msg void OnUpdateEditUndo(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateEditRedo(CCmdUI* pCmdUI);
 };
 
 